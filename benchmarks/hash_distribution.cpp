@@ -0,0 +1,272 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Reports how the hash policies distribute expressions over the node tables
+// of an IHTFactory. For every corpus and policy, prints how many distinct
+// nodes share a hash, which the factory has to tell apart by comparing them,
+// together with the probe and cluster lengths of the factory holding them.
+//
+// Usage: libexpressions_hash_distribution [file...]
+//
+// Without arguments only the generated corpus is used: all binary operators
+// over 200 atoms and 100000 random binary trees with three or four leaves
+// taken from the same atoms. Every file given is read as a list of
+// s-expressions and reported as a corpus of its own.
+
+#include "libexpressions/expressions/expression_hash.hpp"
+#include "libexpressions/expressions/expression_node_kind.hpp"
+#include "libexpressions/expressions/numeric_value.hpp"
+#include "libexpressions/iht/iht_factory.hpp"
+#include "libexpressions/iht/iht_node.hpp"
+#include "libexpressions/iht/iht_statistics.hpp"
+#include "libexpressions/parsers/ast.hpp"
+#include "libexpressions/parsers/s-expressions/interface.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+    using libexpressions::ExpressionNodeKind;
+
+    // A minimal expression node whose hash is computed by `HashPolicy`, so
+    // that both policies can be measured with the same factory in one
+    // build. Leaves are atoms and literals, identified by their kind and
+    // spelling.
+    template<typename HashPolicy>
+    class CorpusNode final : public IHT::IHTNode<CorpusNode<HashPolicy>> {
+    public:
+        typedef IHT::IHTNodePtr<CorpusNode> NodePtr;
+    private:
+        ExpressionNodeKind kind;
+        std::string text;
+        std::vector<NodePtr> operands;
+        IHT::hash_type hashValue;
+
+        static IHT::hash_type hashOperands(std::vector<NodePtr> const &operands) {
+            typename HashPolicy::OperatorHasher hasher(operands.size());
+            for(auto const &operand : operands) {
+                hasher.add(operand->hash());
+            }
+            return hasher.result();
+        }
+    public:
+        CorpusNode(ExpressionNodeKind paramKind, std::string paramText, IHT::hash_type paramHash)
+            : kind(paramKind), text(std::move(paramText)), hashValue(paramHash) {}
+        explicit CorpusNode(std::vector<NodePtr> paramOperands)
+            : kind(ExpressionNodeKind::EXPRESSION_OPERATOR), operands(std::move(paramOperands)),
+              hashValue(hashOperands(operands)) {}
+
+        IHT::hash_type hash() const {
+            return hashValue;
+        }
+        bool equal_to(CorpusNode const *other) const {
+            return kind == other->kind and text == other->text and operands == other->operands;
+        }
+    };
+
+    // Builds the nodes of a corpus in a factory of its own and records how
+    // many distinct nodes share every hash
+    template<typename HashPolicy>
+    class CorpusBuilder {
+    public:
+        typedef CorpusNode<HashPolicy> Node;
+        typedef typename Node::NodePtr NodePtr;
+    private:
+        IHT::IHTFactory<Node> factory;
+        std::unordered_set<IHT::IHTNode<Node> const *> seen;
+        std::unordered_map<IHT::hash_type, std::size_t> nodesPerHash;
+
+        NodePtr record(NodePtr node) {
+            if(seen.insert(node.get()).second) {
+                ++nodesPerHash[node->hash()];
+            }
+            return node;
+        }
+    public:
+        NodePtr makeAtom(std::string const &symbol) {
+            return record(factory.template createNode<Node>(ExpressionNodeKind::EXPRESSION_ATOM, symbol, HashPolicy::hashSymbol(symbol)));
+        }
+        NodePtr makeLiteral(libexpressions::NumericValue const &value) {
+            auto const kind = std::visit([](auto const &alternative) {
+                typedef std::decay_t<decltype(alternative)> ValueType;
+                if constexpr(std::is_same_v<ValueType, std::int64_t>) {
+                    return ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL;
+                } else if constexpr(std::is_same_v<ValueType, double>) {
+                    return ExpressionNodeKind::EXPRESSION_REAL_LITERAL;
+                } else {
+                    return ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL;
+                }
+            }, value);
+            auto const hash = std::visit([](auto const &alternative) {
+                return HashPolicy::hashLiteral(alternative);
+            }, value);
+            return record(factory.template createNode<Node>(kind, libexpressions::numericValueToString(value), hash));
+        }
+        NodePtr makeOperator(std::vector<NodePtr> operands) {
+            return record(factory.template createNode<Node>(std::move(operands)));
+        }
+        NodePtr makeExpression(libexpressions::parsers::Expression<std::string> const &expression) {
+            if(auto symbol = std::get_if<libexpressions::parsers::AtomicProposition<std::string>>(&expression); symbol != nullptr) {
+                return this->makeAtom(*symbol);
+            }
+            if(auto literal = std::get_if<libexpressions::parsers::NumericLiteral>(&expression); literal != nullptr) {
+                return this->makeLiteral(*literal);
+            }
+            auto const &op = std::get<libexpressions::parsers::Operator<std::string>>(expression);
+            std::vector<NodePtr> operands;
+            operands.reserve(op.operands.size());
+            for(auto const &operand : op.operands) {
+                operands.push_back(this->makeExpression(operand));
+            }
+            return this->makeOperator(std::move(operands));
+        }
+
+        IHT::LengthHistogram nodesPerHashHistogram() const {
+            IHT::LengthHistogram result;
+            for(auto const &[hash, count] : nodesPerHash) {
+                result.add(count);
+            }
+            return result;
+        }
+        std::size_t distinctHashes() const {
+            return nodesPerHash.size();
+        }
+        IHT::IHTFactoryStatistics stats() const {
+            return factory.stats();
+        }
+    };
+
+    constexpr std::size_t generatedAtomCount = 200;
+    constexpr std::size_t generatedTreeCount = 100000;
+    constexpr std::size_t minGeneratedTreeLeaves = 3;
+    constexpr std::size_t maxGeneratedTreeLeaves = 4;
+
+    template<typename HashPolicy>
+    typename CorpusBuilder<HashPolicy>::NodePtr makeRandomTree(CorpusBuilder<HashPolicy> &builder, std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> const &atoms,
+                                                               std::size_t leaves, std::mt19937_64 &random) {
+        if(leaves == 1u) {
+            return atoms[std::uniform_int_distribution<std::size_t>(0, atoms.size() - 1u)(random)];
+        }
+        auto const leftLeaves = std::uniform_int_distribution<std::size_t>(1, leaves - 1u)(random);
+        auto left = makeRandomTree(builder, atoms, leftLeaves, random);
+        auto right = makeRandomTree(builder, atoms, leaves - leftLeaves, random);
+        return builder.makeOperator({std::move(left), std::move(right)});
+    }
+
+    template<typename HashPolicy>
+    std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> buildGeneratedCorpus(CorpusBuilder<HashPolicy> &builder) {
+        std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> atoms;
+        for(std::size_t idx = 0; idx < generatedAtomCount; ++idx) {
+            atoms.push_back(builder.makeAtom("a" + std::to_string(idx)));
+        }
+        std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> roots;
+        for(auto const &left : atoms) {
+            for(auto const &right : atoms) {
+                roots.push_back(builder.makeOperator({left, right}));
+            }
+        }
+        // Seeded, so every policy sees the same trees
+        std::mt19937_64 random(0x5EED);
+        for(std::size_t idx = 0; idx < generatedTreeCount; ++idx) {
+            auto const leaves = std::uniform_int_distribution<std::size_t>(minGeneratedTreeLeaves, maxGeneratedTreeLeaves)(random);
+            roots.push_back(makeRandomTree(builder, atoms, leaves, random));
+        }
+        return roots;
+    }
+
+    template<typename HashPolicy>
+    std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> buildParsedCorpus(CorpusBuilder<HashPolicy> &builder, libexpressions::parsers::ExpressionList<std::string> const &expressions) {
+        std::vector<typename CorpusBuilder<HashPolicy>::NodePtr> roots;
+        roots.reserve(expressions.size());
+        for(auto const &expression : expressions) {
+            roots.push_back(builder.makeExpression(expression));
+        }
+        return roots;
+    }
+
+    template<typename HashPolicy, typename BuildCorpus>
+    void report(std::string const &corpusName, char const *policyName, BuildCorpus &&buildCorpus) {
+        CorpusBuilder<HashPolicy> builder;
+        auto const start = std::chrono::steady_clock::now();
+        auto const roots = buildCorpus(builder);
+        auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        auto const statistics = builder.stats();
+        std::cout << "corpus: " << corpusName << '\n'
+                  << "policy: " << policyName << '\n'
+                  << "roots: " << roots.size() << '\n'
+                  << "build ms: " << elapsed.count() << '\n'
+                  << "distinct nodes: " << statistics.liveNodes << '\n'
+                  << "distinct hashes: " << builder.distinctHashes() << '\n'
+                  << "nodes per hash: ";
+        builder.nodesPerHashHistogram().printText(std::cout);
+        std::cout << '\n'
+                  << "table slots: " << statistics.tableSlots << '\n'
+                  << "max probe length: " << statistics.maxProbeLength << '\n'
+                  << "mean probe length: " << statistics.meanProbeLength << '\n'
+                  << "probe lengths: ";
+        statistics.probeLengths.printText(std::cout);
+        std::cout << '\n'
+                  << "cluster lengths: ";
+        statistics.clusterLengths.printText(std::cout);
+        std::cout << "\n\n";
+    }
+
+    template<typename BuildCorpus>
+    void reportAllPolicies(std::string const &corpusName, BuildCorpus &&buildCorpus) {
+        report<libexpressions::StructuralHashPolicy>(corpusName, "structural", buildCorpus);
+        report<libexpressions::XorHashPolicy>(corpusName, "xor", buildCorpus);
+    }
+}
+
+int main(int argc, char **argv) {
+    reportAllPolicies("generated", [](auto &builder) {
+        return buildGeneratedCorpus(builder);
+    });
+    libexpressions::parsers::SExpressionRepresentationInterface parser;
+    for(int idx = 1; idx < argc; ++idx) {
+        std::ifstream file(argv[idx]);
+        if(not file) {
+            std::cerr << "cannot read " << argv[idx] << '\n';
+            return 1;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        auto const expressions = parser.stringToExpressionList(contents.str());
+        reportAllPolicies(argv[idx], [&expressions](auto &builder) {
+            return buildParsedCorpus(builder, expressions);
+        });
+    }
+    return 0;
+}
@@ -25,10 +25,18 @@
 #include "libexpressions/expressions/expression_node.hpp"
 #include "libexpressions/expressions/atom.hpp"
 #include "libexpressions/expressions/operator.hpp"
+#include "libexpressions/expressions/literal.hpp"
 #include "libexpressions/expressions/expression_visit_helper.hpp"
+#include "libexpressions/expressions/expression_store.hpp"
 #include "libexpressions/utils/expression-tree-visit.hpp"
 #include "libexpressions/utils/trie_node.hpp"
 
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
 namespace libexpressions {
     template<typename TypeRepresentationType, typename ValueRepresentationType>
     class Semantics {
@@ -38,6 +46,35 @@ namespace libexpressions {
         virtual EvaluationState evaluateNonOperatorTerminal(std::string const &c) = 0;
         virtual EvaluationState evaluateOperatorTerminal(std::string const &c) = 0;
         virtual EvaluationState evaluateOperator(EvaluationState const &op, std::vector<EvaluationState> const &operands) = 0;
+        // Literals are passed by value, except in the position of an
+        // operator, where they are evaluated as operator terminals like
+        // atoms. By default, they are evaluated like non-operator terminals.
+        // Literals are hash-consed by value, so they are always spelled in
+        // the canonical form of numericValueToString, e.g. `7` for `007`.
+        virtual EvaluationState evaluateIntegerLiteral(std::int64_t value) {
+            return this->evaluateNonOperatorTerminal(numericValueToString(value));
+        }
+        virtual EvaluationState evaluateRealLiteral(double value) {
+            return this->evaluateNonOperatorTerminal(numericValueToString(value));
+        }
+        virtual EvaluationState evaluateBigIntegerLiteral(BigInteger const &value) {
+            return this->evaluateNonOperatorTerminal(numericValueToString(value));
+        }
+
+        EvaluationState evaluateLiteral(std::int64_t value) {
+            return this->evaluateIntegerLiteral(value);
+        }
+        EvaluationState evaluateLiteral(double value) {
+            return this->evaluateRealLiteral(value);
+        }
+        EvaluationState evaluateLiteral(BigInteger const &value) {
+            return this->evaluateBigIntegerLiteral(value);
+        }
+        EvaluationState evaluateLiteral(NumericValue const &value) {
+            return std::visit([this](auto const &alternative) {
+                return this->evaluateLiteral(alternative);
+            }, value);
+        }
     };
 
     template<typename TypeRepresentationType, typename ValueRepresentationType>
@@ -52,6 +89,10 @@ namespace libexpressions {
             Path const &position;
             TrieNode const &values;
             Semantics &semantics;
+
+            bool isOperatorPosition() const {
+                return not position.empty() and position.back() == 0;
+            }
         public:
             ExpressionNodeEvaluationVisitor(Path const &pos, TrieNode const &data, Semantics &sem)
              : position(pos), values(data), semantics(sem) { }
@@ -64,11 +105,29 @@ namespace libexpressions {
                 return semantics.evaluateOperator(op, operands);
             }
             typename Semantics::EvaluationState operator()(libexpressions::Atom const *atom) {
-                if(not position.empty() and position.back() == 0) {
-                    return semantics.evaluateOperatorTerminal(atom->toString());
+                if(this->isOperatorPosition()) {
+                    return semantics.evaluateOperatorTerminal(atom->getSymbol());
                 } else {
-                    return semantics.evaluateNonOperatorTerminal(atom->toString());
+                    return semantics.evaluateNonOperatorTerminal(atom->getSymbol());
+                }
+            }
+            typename Semantics::EvaluationState operator()(libexpressions::IntegerLiteral const *literal) {
+                if(this->isOperatorPosition()) {
+                    return semantics.evaluateOperatorTerminal(numericValueToString(literal->getValue()));
                 }
+                return semantics.evaluateIntegerLiteral(literal->getValue());
+            }
+            typename Semantics::EvaluationState operator()(libexpressions::RealLiteral const *literal) {
+                if(this->isOperatorPosition()) {
+                    return semantics.evaluateOperatorTerminal(numericValueToString(literal->getValue()));
+                }
+                return semantics.evaluateRealLiteral(literal->getValue());
+            }
+            typename Semantics::EvaluationState operator()(libexpressions::BigIntegerLiteral const *literal) {
+                if(this->isOperatorPosition()) {
+                    return semantics.evaluateOperatorTerminal(numericValueToString(literal->getValue()));
+                }
+                return semantics.evaluateBigIntegerLiteral(literal->getValue());
             }
         };
 
@@ -82,5 +141,64 @@ namespace libexpressions {
                                                             node);
         return evaluationResults.value();
     }
+
+    // Evaluates an expression held by an ExpressionStore without converting
+    // it to nodes. The value of a subexpression only depends on whether it
+    // is the operator of its parent, so every distinct subexpression is
+    // evaluated at most once in either position and shared ones are not
+    // evaluated once per path.
+    template<typename TypeRepresentationType, typename ValueRepresentationType>
+    typename Semantics<TypeRepresentationType, ValueRepresentationType>::EvaluationState
+    evaluateExpression(ExprRef node, ExpressionStore const &store, Semantics<TypeRepresentationType, ValueRepresentationType> &semantics) {
+        using Semantics = Semantics<TypeRepresentationType, ValueRepresentationType>;
+        auto const keyOf = [](ExprRef ref, bool isOperator) {
+            return (static_cast<std::uint64_t>(ref.getIndex()) << 1u) | (isOperator ? 1u : 0u);
+        };
+
+        std::unordered_map<std::uint64_t, typename Semantics::EvaluationState> values;
+        // Subexpressions being evaluated, whether they are in the position
+        // of an operator, and the index of their next operand
+        std::vector<std::tuple<ExprRef, bool, std::size_t>> stack;
+        stack.emplace_back(node, false, 0);
+        while(not stack.empty()) {
+            auto &[ref, isOperator, nextOperand] = stack.back();
+            auto const key = keyOf(ref, isOperator);
+            if(nextOperand == 0 and values.find(key) != values.end()) {
+                stack.pop_back();
+            } else if(store.isAtom(ref)) {
+                if(isOperator) {
+                    values.emplace(key, semantics.evaluateOperatorTerminal(store.getSymbol(ref)));
+                } else {
+                    values.emplace(key, semantics.evaluateNonOperatorTerminal(store.getSymbol(ref)));
+                }
+                stack.pop_back();
+            } else if(store.isLiteral(ref)) {
+                if(isOperator) {
+                    values.emplace(key, semantics.evaluateOperatorTerminal(numericValueToString(store.getLiteralValue(ref))));
+                } else {
+                    values.emplace(key, semantics.evaluateLiteral(store.getLiteralValue(ref)));
+                }
+                stack.pop_back();
+            } else if(auto const operands = store.getOperands(ref); nextOperand < operands.size()) {
+                auto const operand = operands[nextOperand];
+                bool const operandIsOperator = nextOperand == 0;
+                ++nextOperand;
+                stack.emplace_back(operand, operandIsOperator, 0);
+            } else {
+                if(operands.empty()) {
+                    throw std::out_of_range("Operator without operands");
+                }
+                auto const &op = values.at(keyOf(operands[0], true));
+                std::vector<typename Semantics::EvaluationState> operandValues;
+                operandValues.reserve(operands.size() - 1u);
+                for(std::size_t idx = 1; idx < operands.size(); ++idx) {
+                    operandValues.push_back(values.at(keyOf(operands[idx], false)));
+                }
+                values.emplace(key, semantics.evaluateOperator(op, operandValues));
+                stack.pop_back();
+            }
+        }
+        return values.at(keyOf(node, false));
+    }
 }
 
@@ -23,43 +23,99 @@
 #pragma once
 
 #include "libexpressions/expressions/expression_node.hpp"
+#include "libexpressions/expressions/expression_hash.hpp"
+#include "libexpressions/expressions/symbol_table.hpp"
 
 #include <string>
+#include <string_view>
 #include <memory>
 
 namespace libexpressions {
     template<typename T>
     class EvaluateableTheory;
 
+    // Atoms only store the id of their symbol in the SymbolTable
     class Atom final : public ExpressionNode {
         friend class IHT::IHTFactory<ExpressionNode>;
     private:
-        std::string const symbol;
+        SymbolId const symbolId;
     protected:
-        Atom(std::string paramSymbol)
+        Atom(std::string_view paramSymbol)
             : ExpressionNode(ExpressionNodeKind::EXPRESSION_ATOM),
-              symbol(paramSymbol) {}
+              symbolId(SymbolTable::get().intern(paramSymbol)) {}
+        // Used when the hash has already been computed for a lookup key
+        Atom(std::string_view paramSymbol, IHT::hash_type paramHash)
+            : ExpressionNode(ExpressionNodeKind::EXPRESSION_ATOM),
+              symbolId(SymbolTable::get().intern(paramSymbol, paramHash)) {}
     public:
-        virtual ~Atom() = default;
+        // Lookup key for IHT::IHTFactory::createNodeWithKey, identifying an
+        // atom by its symbol without constructing it.
+        class Key {
+        private:
+            std::string_view const symbol;
+            IHT::hash_type const hashValue;
+        public:
+            explicit Key(std::string_view paramSymbol)
+                : symbol(paramSymbol),
+                  hashValue(Atom::hashOf(paramSymbol)) {}
+
+            IHT::hash_type hash() const {
+                return hashValue;
+            }
+            bool equal_to(ExpressionNode const *node) const {
+                return Atom::classof(node) and static_cast<Atom const *>(node)->getSymbol() == symbol;
+            }
+        };
+
+        Atom(Atom const &) = delete;
+        Atom &operator=(Atom const &) = delete;
+        virtual ~Atom() {
+            SymbolTable::get().release(symbolId);
+        }
+
+        static IHT::hash_type hashOf(std::string_view symbol) {
+            return ExpressionHashPolicy::hashSymbol(symbol);
+        }
 
         std::string const &getSymbol() const {
-            return symbol;
+            return SymbolTable::get().symbolOf(symbolId);
+        }
+
+        SymbolId getSymbolId() const {
+            return symbolId;
         }
 
         IHT::hash_type hash() const {
-            auto symHash = std::hash<std::string>{}(symbol);
-            symHash ^= (((symHash & 0xFFu) << (sizeof(decltype(symHash))-1u)*8u) & ~0xFFu);
-            return symHash;
+            return SymbolTable::get().hashOf(symbolId);
         }
 
         std::string toString() const {
-            return symbol;
+            return this->getSymbol();
+        }
+
+        std::uint32_t getDepth() const {
+            return 1;
+        }
+        std::uint64_t getTreeSize() const {
+            return 1;
+        }
+        DagSizeSketch getDagSizeSketch() const {
+            return DagSizeSketch::of(this->hash());
+        }
+        SymbolSignature getSymbolSignature() const {
+            return SymbolSignature::of(symbolId);
+        }
+
+        // The symbol is owned by the SymbolTable and shared by all atoms
+        // referring to it
+        std::size_t memoryFootprint() const {
+            return sizeof(Atom);
         }
 
         bool equal_to(ExpressionNode const *other) const {
             if(Atom::classof(other)) {
                 Atom const *atom = static_cast<Atom const *>(other);
-                return atom->symbol == this->symbol;
+                return atom->symbolId == this->symbolId;
             }
             return false;
         }
@@ -68,6 +124,6 @@ namespace libexpressions {
         }
     };
 
-    typedef std::shared_ptr<Atom> ExpressionAtomPtr;
+    typedef IHT::IHTPtr<Atom> ExpressionAtomPtr;
 }
 
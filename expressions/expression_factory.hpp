@@ -27,11 +27,15 @@
 #include <map>
 #include <set>
 #include <iostream>
+#include <unordered_map>
 
 #include "libexpressions/expressions/expression_node.hpp"
 #include "libexpressions/expressions/atom.hpp"
 #include "libexpressions/expressions/operator.hpp"
+#include "libexpressions/expressions/literal.hpp"
 #include "libexpressions/expressions/expression_visit_helper.hpp"
+#include "libexpressions/expressions/expression_memory_report.hpp"
+#include "libexpressions/expressions/fresh_symbol_counters.hpp"
 #include "libexpressions/iht/iht_factory.hpp"
 #include "libexpressions/utils/variadic-insert.hpp"
 #include "libexpressions/utils/trie_node.hpp"
@@ -42,51 +46,120 @@ namespace libexpressions {
     class ExpressionFactory {
     private:
         IHT::IHTFactory<ExpressionNode> *factory;
+        // Shared by all expression factories using the same IHT factory
+        std::shared_ptr<FreshSymbolCounters> freshSymbolCounters;
 
-        // A family of functions to create an operand vector for a list of operands given as a list of arguments to the function
-        // Enable this function for cases where the first two arguments are Iterators
+        template<typename Iterator, typename = void>
+        struct IsOperandIterator : std::false_type {};
+        template<typename Iterator>
+        struct IsOperandIterator<Iterator, std::void_t<decltype(*std::declval<Iterator>())>>
+            : std::is_same<typename std::decay<decltype(*std::declval<Iterator>())>::type, ExpressionNodePtr> {};
+
+        template<typename Range, typename = void>
+        struct IsOperandRange : std::false_type {};
+        template<typename Range>
+        struct IsOperandRange<Range, std::void_t<decltype(std::begin(std::declval<Range&>())), decltype(std::end(std::declval<Range&>()))>>
+            : IsOperandIterator<decltype(std::begin(std::declval<Range&>()))> {};
+
+        template<typename Range, typename = void>
+        struct HasContiguousOperands : std::false_type {};
+        template<typename Range>
+        struct HasContiguousOperands<Range, std::void_t<decltype(std::data(std::declval<Range&>())), decltype(std::size(std::declval<Range&>()))>>
+            : std::is_convertible<decltype(std::data(std::declval<Range&>())), ExpressionNodePtr const*> {};
+
+        // A family of functions appending the operands given as a list of
+        // arguments to an operand vector in a single pass. Arguments are
+        // operands, symbols of atoms, vectors of operands or pairs of
+        // iterators over operands.
         // This function is enabled for cases where the first two arguments are Iterators
         template<typename IIterator1, typename IIterator2, typename ...Args, typename = std::enable_if_t<
-            std::conjunction_v<
-                std::is_same<typename std::decay<decltype(*std::declval<IIterator1>())>::type, ExpressionNodePtr>,
-                std::is_same<typename std::decay<decltype(*std::declval<IIterator2>())>::type, ExpressionNodePtr>
-            >>>
-        std::vector<ExpressionNodePtr> getOperandVector(IIterator1 &&first, IIterator2 &&last, Args&&... args) {
-            std::vector<ExpressionNodePtr> operands(std::forward<IIterator1>(first), std::forward<IIterator2>(last));
-            auto further = getOperandVector(std::forward<Args>(args)...);
-            operands.insert(operands.end(), further.begin(), further.end());
-            return operands;
+            IsOperandIterator<IIterator1>::value and IsOperandIterator<IIterator2>::value>>
+        void appendOperands(OperandContainer &operands, IIterator1 &&first, IIterator2 &&last, Args&&... args) {
+            operands.insert(operands.end(), std::forward<IIterator1>(first), std::forward<IIterator2>(last));
+            this->appendOperands(operands, std::forward<Args>(args)...);
         }
-        // This function is used for cases where the first argument is an expression node pointer
         template<typename ...Args>
-        std::vector<ExpressionNodePtr> getOperandVector(ExpressionNodePtr operand, Args&&... args) {
-            std::vector<ExpressionNodePtr> operands;
-            operands.emplace_back(operand);
-            auto further = getOperandVector(std::forward<Args>(args)...);
-            operands.insert(operands.end(), further.begin(), further.end());
-            return operands;
+        void appendOperands(OperandContainer &operands, ExpressionNodePtr operand, Args&&... args) {
+            operands.emplace_back(std::move(operand));
+            this->appendOperands(operands, std::forward<Args>(args)...);
         }
-        // This function is used for cases where the first argument is a string
         template<typename ...Args>
-        std::vector<ExpressionNodePtr> getOperandVector(std::string operand, Args&&... args) {
-            std::vector<ExpressionNodePtr> operands;
-            operands.emplace_back(std::static_pointer_cast<ExpressionNode const>(factory->createNode<Atom>(operand)));
-            auto further = getOperandVector(std::forward<Args>(args)...);
-            operands.insert(operands.end(), further.begin(), further.end());
-            return operands;
+        void appendOperands(OperandContainer &operands, std::string const &operand, Args&&... args) {
+            operands.emplace_back(this->makeIdentifier(operand));
+            this->appendOperands(operands, std::forward<Args>(args)...);
         }
-        // Slightly optimized version for adding whole containers.
-        // This does not copy by using the iterators but simply copies the
-        // whole vector and then appends to it.
         template<typename ...Args>
-        std::vector<ExpressionNodePtr> getOperandVector(std::vector<ExpressionNodePtr> operands, Args&&... args) {
-            auto further = getOperandVector(std::forward<Args>(args)...);
+        void appendOperands(OperandContainer &operands, OperandContainer const &further, Args&&... args) {
             operands.insert(operands.end(), further.begin(), further.end());
-            return operands;
+            this->appendOperands(operands, std::forward<Args>(args)...);
+        }
+        template<typename ...Args>
+        void appendOperands(OperandContainer &operands, OperandContainer &&further, Args&&... args) {
+            operands.insert(operands.end(), std::make_move_iterator(further.begin()), std::make_move_iterator(further.end()));
+            this->appendOperands(operands, std::forward<Args>(args)...);
+        }
+        void appendOperands(OperandContainer &) {}
+
+        // The number of operands appendOperands appends for the same
+        // arguments, not counting pairs of input iterators, which can only
+        // be traversed once
+        template<typename IIterator1, typename IIterator2, typename ...Args, typename = std::enable_if_t<
+            IsOperandIterator<IIterator1>::value and IsOperandIterator<IIterator2>::value>>
+        static std::size_t countOperands(IIterator1 const &first, IIterator2 const &last, Args const &... args) {
+            std::size_t count = 0;
+            if constexpr(std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<std::decay_t<IIterator1>>::iterator_category>) {
+                count = static_cast<std::size_t>(std::distance(first, last));
+            }
+            return count + countOperands(args...);
+        }
+        template<typename ...Args>
+        static std::size_t countOperands(ExpressionNodePtr const &, Args const &... args) {
+            return 1u + countOperands(args...);
+        }
+        template<typename ...Args>
+        static std::size_t countOperands(std::string_view, Args const &... args) {
+            return 1u + countOperands(args...);
+        }
+        template<typename ...Args>
+        static std::size_t countOperands(OperandContainer const &further, Args const &... args) {
+            return further.size() + countOperands(args...);
+        }
+        static std::size_t countOperands() {
+            return 0;
+        }
+
+        static std::vector<ExpressionNodePtr> toExpressionNodePtrs(std::vector<IHT::IHTNodePtr<ExpressionNode>> &&nodes) {
+            std::vector<ExpressionNodePtr> result;
+            result.reserve(nodes.size());
+            for(auto &node : nodes) {
+                result.emplace_back(IHT::static_pointer_cast<ExpressionNode const>(std::move(node)));
+            }
+            return result;
+        }
+        static void scatter(std::vector<ExpressionNodePtr> &result, std::vector<std::size_t> const &indices, std::vector<IHT::IHTNodePtr<ExpressionNode>> &&nodes) {
+            for(std::size_t idx = 0; idx < indices.size(); ++idx) {
+                result[indices[idx]] = IHT::static_pointer_cast<ExpressionNode const>(std::move(nodes[idx]));
+            }
+        }
+        static void scatter(std::vector<ExpressionNodePtr> &result, std::vector<std::size_t> const &indices, std::vector<ExpressionNodePtr> &&nodes) {
+            for(std::size_t idx = 0; idx < indices.size(); ++idx) {
+                result[indices[idx]] = std::move(nodes[idx]);
+            }
+        }
+        // Atoms and literals of any factory
+        ExpressionNodePtr reproduceLeaf(ExpressionNode const *leaf) {
+            if(auto const atom = dyn_cast<Atom>(leaf); atom != nullptr) {
+                return this->makeIdentifier(atom->getSymbol());
+            }
+            return this->makeLiteral(getNumericValue(leaf).value());
         }
-        // This function is used for no arguments
-        std::vector<ExpressionNodePtr> getOperandVector() {
-            return {};
+
+        std::optional<ExpressionNodePtr> tryMakeNewIdentifier(std::string const &symbol) {
+            Atom::Key const key(symbol);
+            if(auto node = factory->tryCreateNewNodeWithKey<Atom>(key, symbol, key.hash())) {
+                return IHT::static_pointer_cast<ExpressionNode const>(std::move(node).value());
+            }
+            return std::nullopt;
         }
     public:
         static ExpressionFactory * get() {
@@ -94,7 +167,15 @@ namespace libexpressions {
             return singleton.get();
         }
 
-        ExpressionFactory(IHT::IHTFactory<ExpressionNode> *paramFactory) : factory(paramFactory) {}
+        ExpressionFactory(IHT::IHTFactory<ExpressionNode> *paramFactory)
+            : factory(paramFactory),
+              freshSymbolCounters(paramFactory->getAttachment<FreshSymbolCounters>()) {}
+
+        // Cheap enough to be queried regularly, see
+        // IHT::IHTFactory::memoryReport
+        ExpressionMemoryReport memoryReport() const {
+            return ExpressionMemoryReport::of(factory->memoryReport());
+        }
 
         // Creates an expression composed of other expressions, i.e. an
         // operator. If the expressions given as arguments were produced with a
@@ -104,126 +185,432 @@ namespace libexpressions {
         // importantly, comparisons for equality are effected, as
         // `exp1->equal_to(exp2) != (exp1 == exp2)` if `exp1` and `exp2` were
         // produced with different underlying IHT factories.
+        // The arguments are collected in a single pass, see appendOperands.
         template<typename ...Args>
         ExpressionNodePtr makeExpression(Args&&... args) {
-            auto operandVector = getOperandVector(std::forward<Args>(args)...);
-            return std::static_pointer_cast<ExpressionNode const>(
-                factory->createNode<Operator>(std::move(operandVector))
+            OperandContainer operands;
+            operands.reserve(countOperands(args...));
+            this->appendOperands(operands, std::forward<Args>(args)...);
+            return this->makeExpression(std::move(operands));
+        }
+        // The operands are moved into the operator
+        ExpressionNodePtr makeExpression(OperandContainer &&operands) {
+            Operator::Key const key(operands);
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<Operator>(key, std::move(operands), key.hash())
+            );
+        }
+        // The operands are only copied if there is no equivalent operator
+        // yet. Any contiguous range of operands, e.g. the operands of
+        // another operator, can be passed as an OperandRange.
+        ExpressionNodePtr makeExpression(OperandRange operands) {
+            Operator::Key const key(operands.begin(), operands.size());
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<Operator>(key, operands.begin(), operands.size(), key.hash())
             );
         }
+        ExpressionNodePtr makeExpression(std::initializer_list<ExpressionNodePtr> operands) {
+            return this->makeExpression(OperandRange(operands.begin(), operands.size()));
+        }
+        // Ranges whose elements are operands. Operands of ranges which are
+        // not contiguous are collected first and moved from if the range
+        // yields rvalues.
+        template<typename Range, typename = std::enable_if_t<IsOperandRange<Range>::value>>
+        ExpressionNodePtr makeExpression(Range &&range) {
+            if constexpr(HasContiguousOperands<Range>::value) {
+                return this->makeExpression(OperandRange(std::data(range), std::size(range)));
+            } else {
+                OperandContainer operands;
+                typedef decltype(std::begin(range)) Iterator;
+                if constexpr(std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>) {
+                    operands.reserve(static_cast<std::size_t>(std::distance(std::begin(range), std::end(range))));
+                }
+                for(auto &&operand : range) {
+                    operands.emplace_back(std::forward<decltype(operand)>(operand));
+                }
+                return this->makeExpression(std::move(operands));
+            }
+        }
         ExpressionNodePtr makeIdentifier(std::string const &arg) {
-            return std::static_pointer_cast<ExpressionNode const>(
-                factory->createNode<Atom>(arg));
+            Atom::Key const key(arg);
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<Atom>(key, arg, key.hash()));
+        }
+        ExpressionNodePtr makeIntegerLiteral(std::int64_t value) {
+            IntegerLiteral::Key const key(value);
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<IntegerLiteral>(key, value, key.hash()));
         }
+        // Integers that fit into 64 bits are represented by an
+        // IntegerLiteral, so every integer has a single representation
+        ExpressionNodePtr makeIntegerLiteral(BigInteger const &value) {
+            if(value.fitsInt64()) {
+                return this->makeIntegerLiteral(value.toInt64());
+            }
+            BigIntegerLiteral::Key const key(value);
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<BigIntegerLiteral>(key, value, key.hash()));
+        }
+        ExpressionNodePtr makeRealLiteral(double value) {
+            RealLiteral::Key const key(value);
+            return IHT::static_pointer_cast<ExpressionNode const>(
+                factory->createNodeWithKey<RealLiteral>(key, value, key.hash()));
+        }
+        ExpressionNodePtr makeLiteral(NumericValue const &value) {
+            if(auto const *integer = std::get_if<std::int64_t>(&value)) {
+                return this->makeIntegerLiteral(*integer);
+            } else if(auto const *real = std::get_if<double>(&value)) {
+                return this->makeRealLiteral(*real);
+            } else {
+                return this->makeIntegerLiteral(std::get<BigInteger>(value));
+            }
+        }
+        // Creates an atom which did not exist before. Its symbol is `prefix`
+        // if there is no such atom yet, and `prefix_N` otherwise, where N is
+        // taken from a counter per prefix shared by all expression factories
+        // using the same IHT factory. As no suffix is tried twice, atoms of
+        // the form `prefix_N` created by other means are the only reason to
+        // try more than two symbols. Such symbols are not reserved, so every
+        // candidate is still looked up in the IHT factory. Thread-safe.
         ExpressionNodePtr makeNewIdentifier(std::string const &prefix) {
-            std::optional<IHT::IHTNodePtr<ExpressionNode>> node;
-            std::string id = prefix;
-            size_t suffix = 0;
-            do {
-                node = factory->tryCreateNewNode<Atom>(id);
-                if(not node.has_value()) {
-                    id = prefix + "_" + std::to_string(suffix++);
-                    //id = prefix + std::to_string(std::hash<std::string>{}(id));
+            if(auto node = this->tryMakeNewIdentifier(prefix)) {
+                return std::move(node).value();
+            }
+            while(true) {
+                auto const suffix = freshSymbolCounters->reserve(prefix);
+                if(auto node = this->tryMakeNewIdentifier(FreshSymbolCounters::symbolOf(prefix, suffix))) {
+                    return std::move(node).value();
                 }
-            } while(not node.has_value()); 
-            return std::static_pointer_cast<ExpressionNode const>(node.value());
+            }
+        }
+        // Creates `count` atoms as if by calling makeNewIdentifier `count`
+        // times, but reserves the suffixes at once
+        std::vector<ExpressionNodePtr> makeNewIdentifiers(std::string const &prefix, std::size_t count) {
+            std::vector<ExpressionNodePtr> result;
+            result.reserve(count);
+            if(count == 0) {
+                return result;
+            }
+            if(auto node = this->tryMakeNewIdentifier(prefix)) {
+                result.emplace_back(std::move(node).value());
+            }
+            while(result.size() < count) {
+                auto const missing = count - result.size();
+                auto const first = freshSymbolCounters->reserve(prefix, missing);
+                for(std::size_t suffix = first; suffix < first + missing; ++suffix) {
+                    if(auto node = this->tryMakeNewIdentifier(FreshSymbolCounters::symbolOf(prefix, suffix))) {
+                        result.emplace_back(std::move(node).value());
+                    }
+                }
+            }
+            return result;
         }
 
-        ExpressionNodePtr reproduceExpressionInThisFactory(ExpressionNodePtr const &expressionToReproduce) {
-            if(this->factory->hasEquivalentNode(expressionToReproduce)) {
+        // Bulk variants of makeExpression, makeIdentifier and makeLiteral,
+        // which intern a whole batch at once and return the expressions in
+        // the order of the batch, see IHT::IHTFactory::createNodesWithKeys.
+        // No expression of a batch may be an operand of another expression of
+        // the same batch; forests are made level by level, e.g. by
+        // ExpressionStore::materialize.
+        template<typename Executor = IHT::SequentialExecutor>
+        std::vector<ExpressionNodePtr> makeExpressions(std::vector<OperandRange> const &batch, Executor &&executor = Executor()) {
+            return toExpressionNodePtrs(factory->createNodesWithKeys<Operator>(batch.size(), [&batch](std::size_t idx) {
+                return Operator::Key(batch[idx].data(), batch[idx].size());
+            }, [&batch](std::size_t idx) {
+                auto const &operands = batch[idx];
+                return std::make_tuple(operands.data(), operands.size(), Operator::hashOf(operands.data(), operands.size()));
+            }, std::forward<Executor>(executor)));
+        }
+        // `symbols` is a random access range of strings
+        template<typename Symbols, typename Executor = IHT::SequentialExecutor>
+        std::vector<ExpressionNodePtr> makeIdentifiers(Symbols const &symbols, Executor &&executor = Executor()) {
+            return toExpressionNodePtrs(factory->createNodesWithKeys<Atom>(std::size(symbols), [&symbols](std::size_t idx) {
+                return Atom::Key(std::string_view(symbols[idx]));
+            }, [&symbols](std::size_t idx) {
+                return std::make_tuple(std::string_view(symbols[idx]));
+            }, std::forward<Executor>(executor)));
+        }
+        template<typename Executor = IHT::SequentialExecutor>
+        std::vector<ExpressionNodePtr> makeLiterals(std::vector<NumericValue> const &values, Executor &&executor = Executor()) {
+            // Every kind of literal is made in a batch of its own
+            std::vector<std::size_t> integers, reals, bigIntegers;
+            std::vector<std::int64_t> integerValues;
+            for(std::size_t idx = 0; idx < values.size(); ++idx) {
+                if(auto const *integer = std::get_if<std::int64_t>(&values[idx])) {
+                    integers.push_back(idx);
+                    integerValues.push_back(*integer);
+                } else if(std::holds_alternative<double>(values[idx])) {
+                    reals.push_back(idx);
+                } else if(auto const &bigInteger = std::get<BigInteger>(values[idx]); bigInteger.fitsInt64()) {
+                    integers.push_back(idx);
+                    integerValues.push_back(bigInteger.toInt64());
+                } else {
+                    bigIntegers.push_back(idx);
+                }
+            }
+            std::vector<ExpressionNodePtr> result(values.size());
+            scatter(result, integers, factory->createNodesWithKeys<IntegerLiteral>(integers.size(), [&integerValues](std::size_t idx) {
+                return IntegerLiteral::Key(integerValues[idx]);
+            }, [&integerValues](std::size_t idx) {
+                return std::make_tuple(integerValues[idx]);
+            }, executor));
+            scatter(result, reals, factory->createNodesWithKeys<RealLiteral>(reals.size(), [&values,&reals](std::size_t idx) {
+                return RealLiteral::Key(std::get<double>(values[reals[idx]]));
+            }, [&values,&reals](std::size_t idx) {
+                return std::make_tuple(std::get<double>(values[reals[idx]]));
+            }, executor));
+            scatter(result, bigIntegers, factory->createNodesWithKeys<BigIntegerLiteral>(bigIntegers.size(), [&values,&bigIntegers](std::size_t idx) {
+                return BigIntegerLiteral::Key(std::get<BigInteger>(values[bigIntegers[idx]]));
+            }, [&values,&bigIntegers](std::size_t idx) {
+                return std::make_tuple(std::get<BigInteger>(values[bigIntegers[idx]]));
+            }, executor));
+            return result;
+        }
+
+        // Identifies nodes produced with other factories with their
+        // reproductions in this factory, keeping the latter alive. May be
+        // reused across reproductions as long as the nodes it identifies are
+        // alive.
+        typedef std::unordered_map<ExpressionNode const*, ExpressionNodePtr> ReproductionMemo;
+
+        // Reproduces an expression produced with a different underlying IHT
+        // factory in this factory. Every distinct node is reproduced once, so
+        // shared subexpressions are not expanded into trees. Subexpressions
+        // produced with this factory are kept.
+        ExpressionNodePtr reproduceExpressionInThisFactory(ExpressionNodePtr const &expressionToReproduce, ReproductionMemo &memo) {
+            if(factory->owns(expressionToReproduce.get())) {
                 return expressionToReproduce;
             }
-            TrieNode<Operator::PathElement, ExpressionNodePtr> data;
-
-            class ExpressionReproductionVisitor {
-            private:
-                ExpressionFactory *factory;
-                TrieNode<Operator::PathElement, ExpressionNodePtr>::const_iterator begin;
-                TrieNode<Operator::PathElement, ExpressionNodePtr>::const_iterator end;
-            public:
-                ExpressionReproductionVisitor(ExpressionFactory *factoryToUse, TrieNode<Operator::PathElement, ExpressionNodePtr>::const_iterator iterBegin, TrieNode<Operator::PathElement, ExpressionNodePtr>::const_iterator iterEnd)
-                : factory(factoryToUse), begin(iterBegin), end(iterEnd) { }
-                ExpressionNodePtr operator()(Atom const *atom) {
-                    return factory->makeIdentifier(atom->getSymbol());
-                }
-                ExpressionNodePtr operator()(Operator const *op) {
-                    std::vector<ExpressionNodePtr> operands;
-                    std::transform(begin, end, std::back_inserter(operands), [](auto const &element) {
-                        return std::get<std::unique_ptr<TrieNode<Operator::PathElement, ExpressionNodePtr>>>(element)->value();
-                    });
-                    assert(op->getSize() == operands.size());
-                    return factory->makeExpression(operands);
+            OperandContainer operands;
+            std::vector<std::pair<ExpressionNode const*, bool>> stack;
+            stack.emplace_back(expressionToReproduce.get(), false);
+            while(not stack.empty()) {
+                auto const [current, expanded] = stack.back();
+                if(memo.find(current) != memo.end()) {
+                    stack.pop_back();
+                } else if(not Operator::classof(current)) {
+                    memo.emplace(current, this->reproduceLeaf(current));
+                    stack.pop_back();
+                } else if(not expanded) {
+                    stack.back().second = true;
+                    for(auto const &operand : *static_cast<Operator const*>(current)) {
+                        if(not factory->owns(operand.get()) and memo.find(operand.get()) == memo.end()) {
+                            stack.emplace_back(operand.get(), false);
+                        }
+                    }
+                } else {
+                    operands.clear();
+                    for(auto const &operand : *static_cast<Operator const*>(current)) {
+                        operands.push_back(factory->owns(operand.get()) ? operand : memo.at(operand.get()));
+                    }
+                    memo.emplace(current, this->makeExpression(OperandRange(operands.data(), operands.size())));
+                    stack.pop_back();
                 }
-            };
-
-            auto reproducer = [&data,factory=this](auto const &node, auto const &path) {
-                auto &trieNode = data[path];
-                ExpressionReproductionVisitor visitor(factory, trieNode.begin(), trieNode.end());
-                trieNode = libexpressions::visit(node.get(), visitor);
-            };
-            traverseTree<TreeTraversalOrder::POSTFIX_TRAVERSAL>(getChildrenIteratorsForExpressionNode,
-                                                                reproducer,
-                                                                expressionToReproduce);
-            assert(data.value() == expressionToReproduce);
-            return data.value();
+            }
+            return memo.at(expressionToReproduce.get());
+        }
+        ExpressionNodePtr reproduceExpressionInThisFactory(ExpressionNodePtr const &expressionToReproduce) {
+            ReproductionMemo memo;
+            return this->reproduceExpressionInThisFactory(expressionToReproduce, memo);
         }
 
+        // Only reproduces an expression if there is no equivalent expression
+        // in this factory yet. The operands of an operator are reproduced
+        // either way.
         std::optional<ExpressionNodePtr> tryReproduceExpressionInThisFactory(ExpressionNodePtr const &expressionToReproduce) {
-            if(this->factory->hasEquivalentNode(expressionToReproduce)) {
+            if(not Operator::classof(expressionToReproduce.get())) {
+                if(this->factory->hasEquivalentNode(expressionToReproduce)) {
+                    return std::nullopt;
+                }
+                return this->reproduceLeaf(expressionToReproduce.get());
+            }
+            if(factory->owns(expressionToReproduce.get())) {
+                return std::nullopt;
+            }
+            // Comparing with nodes of other factories is structural, so
+            // operators are looked up by their reproduced operands instead
+            ReproductionMemo memo;
+            OperandContainer operands;
+            for(auto const &operand : *static_cast<Operator const*>(expressionToReproduce.get())) {
+                operands.push_back(this->reproduceExpressionInThisFactory(operand, memo));
+            }
+            if(factory->hasNodeWithKey(Operator::Key(operands))) {
                 return std::nullopt;
-            } else {
-                return reproduceExpressionInThisFactory(expressionToReproduce);
             }
+            return this->makeExpression(std::move(operands));
         }
 
+        // Reproduces many expressions at once, every distinct node once. The
+        // nodes are reproduced level by level, grouped by their depth, with
+        // the bulk operations of this factory, using `executor` for every
+        // level. Returns the reproductions in the order of the expressions.
+        template<typename Executor = IHT::SequentialExecutor>
+        std::vector<ExpressionNodePtr> reproduceExpressionsInThisFactory(std::vector<ExpressionNodePtr> const &expressionsToReproduce, Executor &&executor = Executor()) {
+            std::unordered_map<ExpressionNode const*, std::size_t> indices;
+            std::vector<ExpressionNode const*> nodes;
+            std::vector<std::vector<std::size_t>> levels;
+            std::vector<ExpressionNode const*> stack;
+            auto const discover = [&](ExpressionNode const *node) {
+                if(not factory->owns(node) and indices.emplace(node, nodes.size()).second) {
+                    auto const depth = node->getDepth();
+                    if(levels.size() < depth) {
+                        levels.resize(depth);
+                    }
+                    levels[depth - 1u].push_back(nodes.size());
+                    nodes.push_back(node);
+                    stack.push_back(node);
+                }
+            };
+            for(auto const &expression : expressionsToReproduce) {
+                discover(expression.get());
+            }
+            while(not stack.empty()) {
+                auto const current = stack.back();
+                stack.pop_back();
+                if(Operator::classof(current)) {
+                    for(auto const &operand : *static_cast<Operator const*>(current)) {
+                        discover(operand.get());
+                    }
+                }
+            }
+
+            std::vector<ExpressionNodePtr> reproduced(nodes.size());
+            auto const reproductionOf = [&](ExpressionNodePtr const &node) -> ExpressionNodePtr const & {
+                return factory->owns(node.get()) ? node : reproduced[indices.at(node.get())];
+            };
+            std::vector<std::size_t> operators, atoms, literals;
+            OperandContainer operandNodes;
+            std::vector<OperandRange> batch;
+            std::vector<std::string_view> symbols;
+            std::vector<NumericValue> values;
+            // Operands are always at a lower depth than their operators
+            for(auto const &level : levels) {
+                operators.clear();
+                atoms.clear();
+                literals.clear();
+                operandNodes.clear();
+                batch.clear();
+                symbols.clear();
+                values.clear();
+                for(auto const idx : level) {
+                    if(Operator::classof(nodes[idx])) {
+                        operators.push_back(idx);
+                        for(auto const &operand : *static_cast<Operator const*>(nodes[idx])) {
+                            operandNodes.push_back(reproductionOf(operand));
+                        }
+                    } else if(auto const atom = dyn_cast<Atom>(nodes[idx]); atom != nullptr) {
+                        atoms.push_back(idx);
+                        symbols.emplace_back(atom->getSymbol());
+                    } else {
+                        literals.push_back(idx);
+                        values.push_back(getNumericValue(nodes[idx]).value());
+                    }
+                }
+                if(not atoms.empty()) {
+                    scatter(reproduced, atoms, this->makeIdentifiers(symbols, executor));
+                }
+                if(not literals.empty()) {
+                    scatter(reproduced, literals, this->makeLiterals(values, executor));
+                }
+                if(not operators.empty()) {
+                    std::size_t offset = 0;
+                    for(auto const idx : operators) {
+                        auto const count = static_cast<Operator const*>(nodes[idx])->getSize();
+                        batch.emplace_back(operandNodes.data() + offset, count);
+                        offset += count;
+                    }
+                    scatter(reproduced, operators, this->makeExpressions(batch, executor));
+                }
+            }
+
+            std::vector<ExpressionNodePtr> result;
+            result.reserve(expressionsToReproduce.size());
+            for(auto const &expression : expressionsToReproduce) {
+                result.push_back(reproductionOf(expression));
+            }
+            return result;
+        }
+
+        // Replaces the nodes at the given paths. Modifications below a path
+        // which is modified itself have no effect, but their paths have to
+        // be valid nonetheless. Only the operators on the paths to the
+        // modifications are rebuilt; all other subexpressions are shared
+        // with `expressionToModify`. As the paths are sorted, modifications
+        // sharing a prefix are adjacent and the prefix is rebuilt once.
         ExpressionNodePtr modifyExpression(ExpressionNodePtr const &expressionToModify, std::map<Operator::Path, ExpressionNodePtr> const &modificationMap) {
-            // If there are no modifications or there are no modifications that
-            // address any nodes existing within the expression, the code below
-            // does not produce the desired results. We need to catch these
-            // situations.
+            typedef std::map<Operator::Path, ExpressionNodePtr>::const_iterator Modification;
             if(modificationMap.empty()) {
                 return expressionToModify;
-            } else {
-                for(auto const &[path, _] : modificationMap) {
-                    // Any path that does not lead to a node in the expression is invalid.
-                    if(Operator::followPath(expressionToModify, path) == nullptr) {
-                        throw std::runtime_error("Invalid path given for expression modification.");
+            }
+            auto const invalidPath = []() {
+                return std::runtime_error("Invalid path given for expression modification.");
+            };
+            // An operator on the path to some modifications, which are
+            // applied to its operands one group of modifications sharing the
+            // next path element at a time
+            struct Frame {
+                Operator const *op;
+                OperandContainer operands;
+                Modification next;
+                Modification last;
+                std::size_t depth;
+                Operator::PathElement current;
+            };
+            std::vector<Frame> stack;
+            // Returns the modified node if `node` is replaced and otherwise
+            // pushes a frame to rebuild it. `[first, last)` are the
+            // modifications below `node`, which is at depth `depth`.
+            auto const descend = [&stack,&invalidPath](ExpressionNode const *node, Modification first, Modification last, std::size_t depth) -> std::optional<ExpressionNodePtr> {
+                // A path ending here is the smallest of its group
+                if(first->first.size() == depth) {
+                    for(auto ignored = std::next(first); ignored != last; ++ignored) {
+                        auto current = node;
+                        for(auto element = ignored->first.begin() + static_cast<std::ptrdiff_t>(depth); element != ignored->first.end(); ++element) {
+                            if(not Operator::classof(current) or static_cast<Operator const*>(current)->getSize() <= *element) {
+                                throw invalidPath();
+                            }
+                            current = static_cast<Operator const*>(current)->getOperands()[*element].get();
+                        }
                     }
+                    return first->second;
                 }
-            }
+                if(not Operator::classof(node)) {
+                    throw invalidPath();
+                }
+                auto const op = static_cast<Operator const*>(node);
+                auto const operands = op->getOperands();
+                stack.push_back(Frame{op, OperandContainer(operands.begin(), operands.end()), first, last, depth, 0});
+                return std::nullopt;
+            };
 
-            // The actual work is happening here
-            // Get the positions of the modifications in a Trie
-            TrieNode<Operator::PathElement, ExpressionNodePtr> data;
-            for(auto const &[positionToModify, modification] : modificationMap) {
-                data[positionToModify] = modification;
-            }
-            // Traverse the expression to modify and change expressions if and only if
-            // - There is a node (modification) at the same position in the Trie or
-            // - A child node of the Trie node corresponding to the current node contains a node (modification)
-            traverseTree<TreeTraversalOrder::POSTFIX_TRAVERSAL>(getChildrenIteratorsForExpressionNode,
-                                            [&data,this](auto const &node, auto const &path){
-                                                if(not data[path].hasValue()) {
-                                                    if(std::none_of(data[path].begin(), data[path].end(), [](auto const &mapElement){
-                                                        return std::get<std::unique_ptr<TrieNode<Operator::PathElement, ExpressionNodePtr>>>(mapElement)->hasValue();
-                                                    })) {
-                                                        data[path] = node;
-                                                    } else {
-                                                        assert(dynamic_cast<Operator const*>(node.get()) != nullptr);
-                                                        assert(dynamic_cast<Operator const*>(node.get())->getSize() == data[path].size());
-                                                        std::vector<ExpressionNodePtr> operands(data[path].size());
-                                                        for(auto &[idx, ptrToData] : data[path]) {
-                                                            operands.at(idx) = ptrToData->value();
-                                                        }
-                                                        data[path] = this->makeExpression(operands);
-                                                    }
-                                                } else {
-                                                    // Do nothing if there is already a value assigned. This means, this node is to be modified.
-                                                }
-                                            },
-                                            expressionToModify);
-            assert(data.hasValue());
-            return data.value();
+            auto result = descend(expressionToModify.get(), modificationMap.begin(), modificationMap.end(), 0);
+            while(not stack.empty()) {
+                auto &frame = stack.back();
+                if(result.has_value()) {
+                    frame.operands[frame.current] = std::move(result).value();
+                    result.reset();
+                }
+                if(frame.next == frame.last) {
+                    result = this->makeExpression(std::move(frame.operands));
+                    stack.pop_back();
+                    continue;
+                }
+                auto const depth = frame.depth;
+                auto const element = frame.next->first[depth];
+                if(element >= frame.op->getSize()) {
+                    throw invalidPath();
+                }
+                auto const groupFirst = frame.next;
+                auto groupLast = std::next(groupFirst);
+                while(groupLast != frame.last and groupLast->first[depth] == element) {
+                    ++groupLast;
+                }
+                frame.next = groupLast;
+                frame.current = element;
+                // Pushing a frame invalidates `frame`
+                result = descend(frame.op->getOperands()[element].get(), groupFirst, groupLast, depth + 1u);
+            }
+            return std::move(result).value();
         }
     };
 }
@@ -0,0 +1,140 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "libexpressions/iht/iht_node.hpp"
+#include "libexpressions/expressions/expression_node_kind.hpp"
+#include "libexpressions/expressions/numeric_value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+namespace libexpressions {
+    // Hash policies determine the hashes of expression nodes. A policy
+    // provides `hashSymbol`, hashing the symbol of an atom, `hashLiteral`
+    // for the values of numeric literals and
+    // `OperatorHasher`, which is constructed with the number of operands of
+    // an operator, is fed the hashes of the operands in order and yields the
+    // hash of the operator.
+
+    // Mixes the hashes of the operands one after another, so that the hash
+    // depends on the position of every operand, and tags every hash with the
+    // kind of the node. Equivalent nodes of different kinds or with permuted
+    // or repeated operands hash differently with high probability.
+    struct StructuralHashPolicy {
+        // Finaliser of SplitMix64
+        static constexpr std::uint64_t mix(std::uint64_t value) {
+            value ^= value >> 30u;
+            value *= 0xBF58476D1CE4E5B9ull;
+            value ^= value >> 27u;
+            value *= 0x94D049BB133111EBull;
+            value ^= value >> 31u;
+            return value;
+        }
+        static constexpr std::uint64_t kindTag(ExpressionNodeKind kind) {
+            return (static_cast<std::uint64_t>(kind) + 1u) * 0x9E3779B97F4A7C15ull;
+        }
+
+        static IHT::hash_type hashSymbol(std::string_view symbol) {
+            auto const symbolHash = static_cast<std::uint64_t>(std::hash<std::string_view>{}(symbol));
+            return static_cast<IHT::hash_type>(mix(symbolHash ^ kindTag(ExpressionNodeKind::EXPRESSION_ATOM)));
+        }
+
+        static IHT::hash_type hashLiteral(std::int64_t value) {
+            return static_cast<IHT::hash_type>(mix(static_cast<std::uint64_t>(value) ^ kindTag(ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL)));
+        }
+        // Reals are distinguished by their representation, so 0.0 and -0.0
+        // differ
+        static IHT::hash_type hashLiteral(double value) {
+            std::uint64_t bits;
+            static_assert(sizeof(bits) == sizeof(value));
+            std::memcpy(&bits, &value, sizeof(bits));
+            return static_cast<IHT::hash_type>(mix(bits ^ kindTag(ExpressionNodeKind::EXPRESSION_REAL_LITERAL)));
+        }
+        static IHT::hash_type hashLiteral(BigInteger const &value) {
+            std::uint64_t state = mix(kindTag(ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL) + (value.isNegative() ? 1u : 0u));
+            for(auto limb : value.getMagnitude()) {
+                state = mix((state ^ limb) + 0x9E3779B97F4A7C15ull);
+            }
+            return static_cast<IHT::hash_type>(state);
+        }
+
+        class OperatorHasher {
+        private:
+            std::uint64_t state;
+        public:
+            explicit OperatorHasher(std::size_t operandCount)
+                : state(mix(kindTag(ExpressionNodeKind::EXPRESSION_OPERATOR) + operandCount)) {}
+            void add(IHT::hash_type operandHash) {
+                state = mix((state ^ static_cast<std::uint64_t>(operandHash)) + 0x9E3779B97F4A7C15ull);
+            }
+            IHT::hash_type result() const {
+                return static_cast<IHT::hash_type>(state);
+            }
+        };
+    };
+
+    // The original hash: operators combine the hashes of their operands by
+    // XOR and store one more than the highest lowest byte of an operand hash
+    // in their lowest byte. Kept for comparison; operators whose operands
+    // are permuted or repeated collide. Note that the masks only have the
+    // width of an unsigned int.
+    struct XorHashPolicy {
+        static IHT::hash_type hashSymbol(std::string_view symbol) {
+            auto symHash = std::hash<std::string_view>{}(symbol);
+            symHash ^= (((symHash & 0xFFu) << (sizeof(decltype(symHash))-1u)*8u) & ~0xFFu);
+            return symHash;
+        }
+
+        // Literals hash like atoms spelled like them
+        template<typename T>
+        static IHT::hash_type hashLiteral(T const &value) {
+            return hashSymbol(numericValueToString(value));
+        }
+
+        class OperatorHasher {
+        private:
+            IHT::hash_type combined = 0;
+            IHT::hash_type maxLowestByte = 0;
+        public:
+            explicit OperatorHasher(std::size_t) {}
+            void add(IHT::hash_type operandHash) {
+                combined ^= operandHash;
+                maxLowestByte = std::max(maxLowestByte, operandHash & 0xFFu);
+            }
+            IHT::hash_type result() const {
+                return (combined & ~0xFFu) | ((maxLowestByte + 1u) & 0xFFu);
+            }
+        };
+    };
+
+#ifdef LIBEXPRESSIONS_XOR_HASH
+    typedef XorHashPolicy ExpressionHashPolicy;
+#else
+    typedef StructuralHashPolicy ExpressionHashPolicy;
+#endif
+}
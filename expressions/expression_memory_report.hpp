@@ -0,0 +1,129 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+
+#include "libexpressions/expressions/expression_node.hpp"
+#include "libexpressions/expressions/operator.hpp"
+#include "libexpressions/expressions/symbol_table.hpp"
+#include "libexpressions/iht/iht_statistics.hpp"
+
+namespace libexpressions {
+    // The memory report of the IHT factory underlying an ExpressionFactory,
+    // broken down by the kinds of nodes, together with the memory of the
+    // SymbolTable, which is shared by all factories.
+    struct ExpressionMemoryReport {
+        struct KindUsage {
+            std::size_t nodes = 0;
+            std::size_t bytes = 0;
+        };
+
+        IHT::IHTFactoryMemoryReport factory;
+        KindUsage atoms;
+        KindUsage integerLiterals;
+        KindUsage realLiterals;
+        KindUsage bigIntegerLiterals;
+        KindUsage operators;
+        // Part of the bytes of operators taken by their operands
+        std::size_t operandBytes = 0;
+        // Number of operators with arities from the respective bound in
+        // ExpressionNode::operatorArityClassBounds up to the next one
+        std::array<std::size_t, ExpressionNode::operatorArityClassBounds.size()> arityHistogram{};
+        std::size_t symbols = 0;
+        std::size_t symbolTableBytes = 0;
+
+        static ExpressionMemoryReport of(IHT::IHTFactoryMemoryReport const &factoryReport) {
+            ExpressionMemoryReport result;
+            result.factory = factoryReport;
+            auto const usageOf = [&factoryReport](std::size_t nodeClass) {
+                auto const &usage = factoryReport.nodeClasses.at(nodeClass);
+                return KindUsage{usage.nodes, usage.bytes};
+            };
+            result.atoms = usageOf(0);
+            result.integerLiterals = usageOf(1);
+            result.realLiterals = usageOf(2);
+            result.bigIntegerLiterals = usageOf(3);
+            for(std::size_t idx = 0; idx < result.arityHistogram.size(); ++idx) {
+                auto const usage = usageOf(ExpressionNode::leafMemoryClassCount + idx);
+                result.arityHistogram[idx] = usage.nodes;
+                result.operators.nodes += usage.nodes;
+                result.operators.bytes += usage.bytes;
+            }
+            result.operandBytes = result.operators.bytes - result.operators.nodes * sizeof(Operator);
+            result.symbols = SymbolTable::get().size();
+            result.symbolTableBytes = SymbolTable::get().memoryUsage();
+            return result;
+        }
+
+        void printText(std::ostream &out) const {
+            factory.printText(out);
+            out << "atoms: " << atoms.nodes << " nodes, " << atoms.bytes << " bytes\n"
+                << "integer literals: " << integerLiterals.nodes << " nodes, " << integerLiterals.bytes << " bytes\n"
+                << "real literals: " << realLiterals.nodes << " nodes, " << realLiterals.bytes << " bytes\n"
+                << "big integer literals: " << bigIntegerLiterals.nodes << " nodes, " << bigIntegerLiterals.bytes << " bytes\n"
+                << "operators: " << operators.nodes << " nodes, " << operators.bytes << " bytes\n"
+                << "operand bytes: " << operandBytes << '\n';
+            auto const &bounds = ExpressionNode::operatorArityClassBounds;
+            for(std::size_t idx = 0; idx < arityHistogram.size(); ++idx) {
+                out << "operators of arity " << bounds[idx];
+                if(idx + 1u == bounds.size()) {
+                    out << '+';
+                } else if(bounds[idx + 1u] - 1u != bounds[idx]) {
+                    out << '-' << bounds[idx + 1u] - 1u;
+                }
+                out << ": " << arityHistogram[idx] << '\n';
+            }
+            out << "symbols: " << symbols << '\n'
+                << "symbol table bytes: " << symbolTableBytes << '\n';
+        }
+
+        void printJson(std::ostream &out) const {
+            auto const printUsage = [&out](char const *name, KindUsage const &usage) {
+                out << ",\"" << name << "\":{\"nodes\":" << usage.nodes << ",\"bytes\":" << usage.bytes << '}';
+            };
+            out << "{\"factory\":";
+            factory.printJson(out);
+            printUsage("atoms", atoms);
+            printUsage("integerLiterals", integerLiterals);
+            printUsage("realLiterals", realLiterals);
+            printUsage("bigIntegerLiterals", bigIntegerLiterals);
+            printUsage("operators", operators);
+            out << ",\"operandBytes\":" << operandBytes
+                << ",\"arityHistogram\":[";
+            for(std::size_t idx = 0; idx < arityHistogram.size(); ++idx) {
+                out << (idx > 0 ? "," : "") << "{\"minimumArity\":" << ExpressionNode::operatorArityClassBounds[idx] << ",\"operators\":" << arityHistogram[idx] << '}';
+            }
+            out << "],\"symbols\":" << symbols
+                << ",\"symbolTableBytes\":" << symbolTableBytes
+                << '}';
+        }
+    };
+
+    inline std::ostream &operator<<(std::ostream &out, ExpressionMemoryReport const &report) {
+        report.printText(out);
+        return out;
+    }
+}
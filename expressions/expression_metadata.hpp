@@ -0,0 +1,130 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "libexpressions/expressions/expression_hash.hpp"
+#include "libexpressions/expressions/symbol_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace libexpressions {
+    // A Bloom filter of the symbols of the atoms contained in an expression.
+    // If the signature of an expression does not contain the signature of a
+    // symbol, the symbol does not occur in the expression.
+    class SymbolSignature {
+    private:
+        std::uint64_t bits = 0;
+
+        explicit constexpr SymbolSignature(std::uint64_t paramBits) : bits(paramBits) {}
+    public:
+        constexpr SymbolSignature() = default;
+
+        static constexpr SymbolSignature of(SymbolId id) {
+            auto const mixed = StructuralHashPolicy::mix(std::uint64_t(id) + 0x9E3779B97F4A7C15ull);
+            return SymbolSignature((std::uint64_t(1) << (mixed & 63u)) | (std::uint64_t(1) << ((mixed >> 6u) & 63u)));
+        }
+
+        constexpr SymbolSignature merged(SymbolSignature other) const {
+            return SymbolSignature(bits | other.bits);
+        }
+        constexpr bool mayContain(SymbolSignature other) const {
+            return (bits & other.bits) == other.bits;
+        }
+        constexpr bool mayContain(SymbolId id) const {
+            return this->mayContain(SymbolSignature::of(id));
+        }
+        constexpr std::uint64_t getBits() const {
+            return bits;
+        }
+    };
+
+    // A HyperLogLog sketch of the distinct nodes of an expression with 12
+    // registers of 5 bits each. Merging the sketches of the operands counts
+    // shared subexpressions once. Estimates are off by about 30% on average.
+    class DagSizeSketch {
+    private:
+        static constexpr std::size_t registerCount = 12;
+        static constexpr unsigned registerBits = 5;
+        static constexpr std::uint64_t registerMask = (std::uint64_t(1) << registerBits) - 1u;
+
+        std::uint64_t registers = 0;
+
+        explicit constexpr DagSizeSketch(std::uint64_t paramRegisters) : registers(paramRegisters) {}
+
+        constexpr unsigned registerAt(std::size_t idx) const {
+            return static_cast<unsigned>((registers >> (idx * registerBits)) & registerMask);
+        }
+    public:
+        constexpr DagSizeSketch() = default;
+
+        // The sketch of a single node with the given hash
+        static constexpr DagSizeSketch of(IHT::hash_type hash) {
+            auto const mixed = StructuralHashPolicy::mix(static_cast<std::uint64_t>(hash));
+            auto const idx = static_cast<std::size_t>(mixed % registerCount);
+            // One more than the number of leading zeros of the upper 59 bits
+            auto remaining = mixed >> registerBits;
+            std::uint64_t rank = 59u + 1u;
+            while(remaining != 0) {
+                remaining >>= 1u;
+                --rank;
+            }
+            rank = std::min(rank, registerMask);
+            return DagSizeSketch(rank << (idx * registerBits));
+        }
+
+        constexpr DagSizeSketch merged(DagSizeSketch other) const {
+            std::uint64_t result = 0;
+            for(std::size_t idx = 0; idx < registerCount; ++idx) {
+                auto const shift = idx * registerBits;
+                result |= std::max((registers >> shift) & registerMask, (other.registers >> shift) & registerMask) << shift;
+            }
+            return DagSizeSketch(result);
+        }
+
+        double estimate() const {
+            constexpr double m = registerCount;
+            constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+            double sum = 0.0;
+            std::size_t zeros = 0;
+            for(std::size_t idx = 0; idx < registerCount; ++idx) {
+                auto const value = this->registerAt(idx);
+                sum += std::ldexp(1.0, -static_cast<int>(value));
+                zeros += value == 0 ? 1u : 0u;
+            }
+            auto const raw = alpha * m * m / sum;
+            if(raw <= 2.5 * m and zeros > 0) {
+                return m * std::log(m / static_cast<double>(zeros));
+            }
+            return raw;
+        }
+    };
+
+    // Adds tree sizes without overflowing
+    constexpr std::uint64_t saturatingAdd(std::uint64_t lhs, std::uint64_t rhs) {
+        return lhs > std::numeric_limits<std::uint64_t>::max() - rhs ? std::numeric_limits<std::uint64_t>::max() : lhs + rhs;
+    }
+}
@@ -22,7 +22,11 @@
  */
 #include "libexpressions/expressions/expression_node.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "libexpressions/expressions/expression_visit_helper.hpp"
+#include "libexpressions/expressions/expression_writer.hpp"
 
 
 namespace libexpressions {
@@ -33,12 +37,40 @@ namespace libexpressions {
         });
     }
 
-    std::string ExpressionNode::toString() const {
+    std::size_t ExpressionNode::memoryClass() const {
+        switch(this->getKind()) {
+        case ExpressionNodeKind::EXPRESSION_ATOM:
+            return 0;
+        case ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL:
+            return 1;
+        case ExpressionNodeKind::EXPRESSION_REAL_LITERAL:
+            return 2;
+        case ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL:
+            return 3;
+        case ExpressionNodeKind::EXPRESSION_OPERATOR:
+        case ExpressionNodeKind::LAST_EXPRESSION_NODE:
+        default:
+            break;
+        }
+        auto const arity = static_cast<Operator const *>(this)->getSize();
+        auto const bound = std::upper_bound(operatorArityClassBounds.begin(), operatorArityClassBounds.end(), arity);
+        return leafMemoryClassCount + static_cast<std::size_t>(bound - operatorArityClassBounds.begin()) - 1u;
+    }
+
+    std::size_t ExpressionNode::memoryFootprint() const {
         return libexpressions::visit(this, [](auto thisNode) {
-            return thisNode->toString();
+            return thisNode->memoryFootprint();
         });
     }
 
+    std::string ExpressionNode::toString() const {
+        return expressionToString(this);
+    }
+
+    std::string Operator::toString() const {
+        return expressionToString(this);
+    }
+
     IHT::hash_type ExpressionNode::hash() const {
         return libexpressions::visit(this, [](auto thisNode) {
             return thisNode->hash();
@@ -46,9 +78,46 @@ namespace libexpressions {
     }
 
     bool ExpressionNode::equal_to(ExpressionNode const *node) const {
+        if(this == node) {
+            return true;
+        }
+        if(this->isCanonicalWith(node) or this->hash() != node->hash()) {
+            return false;
+        }
         return libexpressions::visit(this, [node](auto thisNode) {
             return thisNode->equal_to(node);
         });
     }
+
+    std::uint32_t ExpressionNode::getDepth() const {
+        return libexpressions::visit(this, [](auto thisNode) {
+            return thisNode->getDepth();
+        });
+    }
+
+    std::uint64_t ExpressionNode::getTreeSize() const {
+        return libexpressions::visit(this, [](auto thisNode) {
+            return thisNode->getTreeSize();
+        });
+    }
+
+    std::uint64_t ExpressionNode::getDagSizeEstimate() const {
+        // There are at least as many distinct nodes as nodes on the longest
+        // path and at most as many as in the tree
+        auto const estimate = static_cast<std::uint64_t>(std::llround(this->getDagSizeSketch().estimate()));
+        return std::clamp<std::uint64_t>(estimate, this->getDepth(), this->getTreeSize());
+    }
+
+    DagSizeSketch ExpressionNode::getDagSizeSketch() const {
+        return libexpressions::visit(this, [](auto thisNode) {
+            return thisNode->getDagSizeSketch();
+        });
+    }
+
+    SymbolSignature ExpressionNode::getSymbolSignature() const {
+        return libexpressions::visit(this, [](auto thisNode) {
+            return thisNode->getSymbolSignature();
+        });
+    }
 }
 
@@ -25,6 +25,10 @@
 #include "libexpressions/iht/iht_node.hpp"
 #include "libexpressions/expressions/expression_node_kind.hpp"
 #include "libexpressions/expressions/expression_visitor.hpp"
+#include "libexpressions/expressions/expression_metadata.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -50,14 +54,42 @@ namespace libexpressions {
 
         IHT::hash_type hash() const;
 
+        // Nodes of the same factory are compared by identity, others by
+        // hash and structure
         bool equal_to(ExpressionNode const *node) const;
 
+        // Metadata computed bottom-up when a node is created
+        // Number of nodes on the longest path from this node to an atom
+        std::uint32_t getDepth() const;
+        // Number of nodes of the expression as a tree, counting shared
+        // subexpressions as often as they occur. Saturates.
+        std::uint64_t getTreeSize() const;
+        // Estimated number of distinct nodes of the expression
+        std::uint64_t getDagSizeEstimate() const;
+        DagSizeSketch getDagSizeSketch() const;
+        // Allows to rule out that an atom occurs in the expression
+        SymbolSignature getSymbolSignature() const;
+        bool mayContainSymbol(SymbolId id) const {
+            return this->getSymbolSignature().mayContain(id);
+        }
+
+        // Classes of nodes in memory reports of the factory: atoms, integer,
+        // real and big integer literals, followed by operators with arities
+        // from one of the bounds below up to the next
+        static constexpr std::size_t leafMemoryClassCount = 4;
+        static constexpr std::array<std::size_t, 10> operatorArityClassBounds{0, 1, 2, 3, 4, 5, 9, 17, 33, 65};
+        static constexpr std::size_t memoryClassCount = leafMemoryClassCount + operatorArityClassBounds.size();
+        std::size_t memoryClass() const;
+        // Bytes occupied by the node, including its operands and out of line
+        // data, but not its control block
+        std::size_t memoryFootprint() const;
+
         static constexpr bool classof(ExpressionNode const *node) {
             return node->getKind() > ExpressionNodeKind::EXPRESSION_NODE && node->getKind() < ExpressionNodeKind::LAST_EXPRESSION_NODE;
         }
     };
 
-    typedef std::shared_ptr<ExpressionNode const> ExpressionNodePtr;
+    typedef IHT::IHTPtr<ExpressionNode const> ExpressionNodePtr;
 
     typedef std::vector<ExpressionNodePtr> ExpressionNodePtrContainer;
 }
@@ -28,6 +28,9 @@ enum class ExpressionNodeKind {
     EXPRESSION_NODE,
     EXPRESSION_OPERATOR = EXPRESSION_NODE,
     EXPRESSION_ATOM,
+    EXPRESSION_INTEGER_LITERAL,
+    EXPRESSION_REAL_LITERAL,
+    EXPRESSION_BIG_INTEGER_LITERAL,
     LAST_EXPRESSION_NODE //Marking the end of the enumeration
 };
 
@@ -0,0 +1,691 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "libexpressions/expressions/expression_factory.hpp"
+#include "libexpressions/expressions/expression_hash.hpp"
+#include "libexpressions/expressions/expression_writer.hpp"
+#include "libexpressions/expressions/numeric_value.hpp"
+#include "libexpressions/expressions/symbol_table.hpp"
+
+namespace libexpressions {
+    // Handle of an expression held by an ExpressionStore
+    class ExprRef {
+    private:
+        std::uint32_t index;
+    public:
+        static constexpr std::uint32_t invalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+        constexpr ExprRef() : index(invalidIndex) {}
+        constexpr explicit ExprRef(std::uint32_t paramIndex) : index(paramIndex) {}
+
+        constexpr std::uint32_t getIndex() const {
+            return index;
+        }
+        constexpr bool isValid() const {
+            return index != invalidIndex;
+        }
+
+        friend constexpr bool operator==(ExprRef lhs, ExprRef rhs) {
+            return lhs.index == rhs.index;
+        }
+        friend constexpr bool operator!=(ExprRef lhs, ExprRef rhs) {
+            return lhs.index != rhs.index;
+        }
+        friend constexpr bool operator<(ExprRef lhs, ExprRef rhs) {
+            return lhs.index < rhs.index;
+        }
+    };
+    static_assert(sizeof(ExprRef) == sizeof(std::uint32_t), "Handles have to stay as small as their index.");
+
+    // Compact representation of expressions for workloads bound by memory.
+    // Expressions are hash-consed like those of an ExpressionFactory, so
+    // equal expressions have equal handles, but they are never released.
+    // Operands of all operators are stored as handles in a single array.
+    // Expressions are converted to and from nodes at API boundaries.
+    //
+    // A store is not thread-safe. It may be read concurrently while no
+    // expressions are added. Adding expressions invalidates operand ranges.
+    class ExpressionStore {
+    public:
+        typedef ExprRef const *Iterator;
+
+        class OperandRange {
+        private:
+            Iterator first;
+            Iterator last;
+        public:
+            OperandRange(Iterator paramFirst, Iterator paramLast) : first(paramFirst), last(paramLast) {}
+
+            Iterator begin() const {
+                return first;
+            }
+            Iterator end() const {
+                return last;
+            }
+            std::size_t size() const {
+                return static_cast<std::size_t>(last - first);
+            }
+            bool empty() const {
+                return first == last;
+            }
+            ExprRef operator[](std::size_t idx) const {
+                return first[idx];
+            }
+        };
+    private:
+        // Atoms keep their symbol in place of the offset of their operands,
+        // literals the index of their value
+        struct Record {
+            std::uint32_t payload;
+            std::uint32_t operandCount;
+        };
+        static constexpr std::uint32_t atomMarker = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::uint32_t integerMarker = atomMarker - 1u;
+        static constexpr std::uint32_t realMarker = atomMarker - 2u;
+        static constexpr std::uint32_t bigIntegerMarker = atomMarker - 3u;
+        // Operators have fewer operands than any marker
+        static constexpr std::uint32_t firstMarker = bigIntegerMarker;
+        static constexpr std::size_t minimumTableCapacity = 64;
+
+        std::vector<Record> records;
+        std::vector<IHT::hash_type> hashes;
+        std::vector<ExprRef> operands;
+        // Integers and the representations of reals
+        std::vector<std::uint64_t> literalValues;
+        std::vector<BigInteger> bigIntegers;
+        // Open addressing table of record indices with linear probing, kept
+        // at most half full
+        std::vector<std::uint32_t> slots;
+
+        static std::size_t firstSlotOf(IHT::hash_type hash, std::size_t capacity) {
+            hash *= static_cast<IHT::hash_type>(0x9E3779B97F4A7C15ull);
+            hash ^= hash >> (sizeof(IHT::hash_type) * 4u);
+            return hash & (capacity - 1u);
+        }
+
+        void rebuildTable(std::size_t capacity) {
+            slots.assign(capacity, ExprRef::invalidIndex);
+            for(std::uint32_t idx = 0; idx < records.size(); ++idx) {
+                auto slot = firstSlotOf(hashes[idx], capacity);
+                while(slots[slot] != ExprRef::invalidIndex) {
+                    slot = (slot + 1u) & (capacity - 1u);
+                }
+                slots[slot] = idx;
+            }
+        }
+
+        // Returns the record matching `record` or adds it
+        template<typename Matches>
+        ExprRef findOrAdd(Record const &record, IHT::hash_type hash, Matches const &matches, ExprRef const *first) {
+            if((records.size() + 1u) * 2u > slots.size()) {
+                this->rebuildTable(std::max(minimumTableCapacity, slots.size() * 2u));
+            }
+            auto const mask = slots.size() - 1u;
+            auto slot = firstSlotOf(hash, slots.size());
+            for(; slots[slot] != ExprRef::invalidIndex; slot = (slot + 1u) & mask) {
+                if(hashes[slots[slot]] == hash and matches(records[slots[slot]])) {
+                    return ExprRef(slots[slot]);
+                }
+            }
+            if(records.size() >= ExprRef::invalidIndex) {
+                throw std::length_error("ExpressionStore ran out of handles");
+            }
+            records.push_back(record);
+            hashes.push_back(hash);
+            if(record.operandCount < firstMarker) {
+                operands.insert(operands.end(), first, first + record.operandCount);
+            }
+            slots[slot] = static_cast<std::uint32_t>(records.size() - 1u);
+            return ExprRef(slots[slot]);
+        }
+
+        // Every atom of the store holds a reference to its symbol
+        ExprRef makeAtom(SymbolId symbol) {
+            auto const recordCount = records.size();
+            auto const ref = this->findOrAdd(Record{symbol, atomMarker}, SymbolTable::get().hashOf(symbol), [symbol](Record const &candidate) {
+                return candidate.operandCount == atomMarker and candidate.payload == symbol;
+            }, nullptr);
+            if(records.size() != recordCount) {
+                SymbolTable::get().acquire(symbol);
+            }
+            return ref;
+        }
+        void releaseSymbols() {
+            for(auto const &record : records) {
+                if(record.operandCount == atomMarker) {
+                    SymbolTable::get().release(record.payload);
+                }
+            }
+        }
+
+        // Literals with 64-bit values share `literalValues`
+        ExprRef makeWordLiteral(std::uint64_t bits, std::uint32_t marker, IHT::hash_type hash) {
+            auto const recordCount = records.size();
+            if(literalValues.size() >= atomMarker) {
+                throw std::length_error("ExpressionStore ran out of literal storage");
+            }
+            auto const ref = this->findOrAdd(Record{static_cast<std::uint32_t>(literalValues.size()), marker}, hash, [this,bits,marker](Record const &candidate) {
+                return candidate.operandCount == marker and literalValues[candidate.payload] == bits;
+            }, nullptr);
+            if(records.size() != recordCount) {
+                literalValues.push_back(bits);
+            }
+            return ref;
+        }
+
+        Record const &recordOf(ExprRef ref) const {
+            assert(ref.getIndex() < records.size());
+            return records[ref.getIndex()];
+        }
+
+        // Access to the expressions of the store for writeExpression
+        struct WriterAccess {
+            ExpressionStore const *store;
+
+            bool isOperator(ExprRef ref) const {
+                return store->getKind(ref) == ExpressionNodeKind::EXPRESSION_OPERATOR;
+            }
+            std::size_t getSize(ExprRef ref) const {
+                return store->getSize(ref);
+            }
+            ExprRef getOperand(ExprRef ref, std::size_t idx) const {
+                return store->getOperands(ref)[idx];
+            }
+            template<typename Sink>
+            void writeLeaf(ExprRef ref, Sink &sink) const {
+                if(store->isAtom(ref)) {
+                    sink(std::string_view(store->getSymbol(ref)));
+                } else {
+                    writeNumericValue(store->getLiteralValue(ref), sink);
+                }
+            }
+        };
+    public:
+        ExpressionStore() = default;
+        ExpressionStore(ExpressionStore const &other)
+            : records(other.records),
+              hashes(other.hashes),
+              operands(other.operands),
+              literalValues(other.literalValues),
+              bigIntegers(other.bigIntegers),
+              slots(other.slots) {
+            for(auto const &record : records) {
+                if(record.operandCount == atomMarker) {
+                    SymbolTable::get().acquire(record.payload);
+                }
+            }
+        }
+        ExpressionStore(ExpressionStore &&other) noexcept
+            : records(std::exchange(other.records, {})),
+              hashes(std::exchange(other.hashes, {})),
+              operands(std::exchange(other.operands, {})),
+              literalValues(std::exchange(other.literalValues, {})),
+              bigIntegers(std::exchange(other.bigIntegers, {})),
+              slots(std::exchange(other.slots, {})) {}
+        ExpressionStore &operator=(ExpressionStore other) noexcept {
+            std::swap(records, other.records);
+            std::swap(hashes, other.hashes);
+            std::swap(operands, other.operands);
+            std::swap(literalValues, other.literalValues);
+            std::swap(bigIntegers, other.bigIntegers);
+            std::swap(slots, other.slots);
+            return *this;
+        }
+        ~ExpressionStore() {
+            this->releaseSymbols();
+        }
+
+        ExprRef makeIdentifier(std::string_view symbol) {
+            auto const id = SymbolTable::get().intern(symbol);
+            auto const ref = this->makeAtom(id);
+            SymbolTable::get().release(id);
+            return ref;
+        }
+
+        ExprRef makeIntegerLiteral(std::int64_t value) {
+            return this->makeWordLiteral(static_cast<std::uint64_t>(value), integerMarker, ExpressionHashPolicy::hashLiteral(value));
+        }
+        // Like ExpressionFactory::makeIntegerLiteral, integers that fit into
+        // 64 bits are stored as such
+        ExprRef makeIntegerLiteral(BigInteger const &value) {
+            if(value.fitsInt64()) {
+                return this->makeIntegerLiteral(value.toInt64());
+            }
+            auto const recordCount = records.size();
+            if(bigIntegers.size() >= atomMarker) {
+                throw std::length_error("ExpressionStore ran out of literal storage");
+            }
+            auto const ref = this->findOrAdd(Record{static_cast<std::uint32_t>(bigIntegers.size()), bigIntegerMarker}, ExpressionHashPolicy::hashLiteral(value), [this,&value](Record const &candidate) {
+                return candidate.operandCount == bigIntegerMarker and bigIntegers[candidate.payload] == value;
+            }, nullptr);
+            if(records.size() != recordCount) {
+                bigIntegers.push_back(value);
+            }
+            return ref;
+        }
+        ExprRef makeRealLiteral(double value) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return this->makeWordLiteral(bits, realMarker, ExpressionHashPolicy::hashLiteral(value));
+        }
+        ExprRef makeLiteral(NumericValue const &value) {
+            if(auto const *integer = std::get_if<std::int64_t>(&value)) {
+                return this->makeIntegerLiteral(*integer);
+            } else if(auto const *real = std::get_if<double>(&value)) {
+                return this->makeRealLiteral(*real);
+            } else {
+                return this->makeIntegerLiteral(std::get<BigInteger>(value));
+            }
+        }
+
+        // Operands have to be handles of this store
+        ExprRef makeExpression(ExprRef const *first, std::size_t count) {
+            // The operands might be stored in the array that is appended to
+            if(first >= operands.data() and first < operands.data() + operands.size()) {
+                std::vector<ExprRef> const copy(first, first + count);
+                return this->makeExpression(copy.data(), copy.size());
+            }
+            if(count >= firstMarker or operands.size() + count > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("ExpressionStore ran out of operand storage");
+            }
+            ExpressionHashPolicy::OperatorHasher hasher(count);
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                hasher.add(hashes[first[idx].getIndex()]);
+            }
+            // Operands are canonical, so comparing their handles suffices
+            Record const record{static_cast<std::uint32_t>(operands.size()), static_cast<std::uint32_t>(count)};
+            return this->findOrAdd(record, hasher.result(), [this,first,count](Record const &candidate) {
+                return candidate.operandCount == count
+                   and std::equal(first, first + count, operands.begin() + candidate.payload);
+            }, first);
+        }
+        ExprRef makeExpression(std::vector<ExprRef> const &paramOperands) {
+            return this->makeExpression(paramOperands.data(), paramOperands.size());
+        }
+        ExprRef makeExpression(std::initializer_list<ExprRef> paramOperands) {
+            return this->makeExpression(paramOperands.begin(), paramOperands.size());
+        }
+
+        ExpressionNodeKind getKind(ExprRef ref) const {
+            switch(this->recordOf(ref).operandCount) {
+            case atomMarker:
+                return ExpressionNodeKind::EXPRESSION_ATOM;
+            case integerMarker:
+                return ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL;
+            case realMarker:
+                return ExpressionNodeKind::EXPRESSION_REAL_LITERAL;
+            case bigIntegerMarker:
+                return ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL;
+            default:
+                return ExpressionNodeKind::EXPRESSION_OPERATOR;
+            }
+        }
+        bool isAtom(ExprRef ref) const {
+            return this->recordOf(ref).operandCount == atomMarker;
+        }
+        bool isLiteral(ExprRef ref) const {
+            auto const marker = this->recordOf(ref).operandCount;
+            return marker >= firstMarker and marker != atomMarker;
+        }
+        // Only valid for literals of the respective kind
+        std::int64_t getIntegerValue(ExprRef ref) const {
+            assert(this->getKind(ref) == ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL);
+            return static_cast<std::int64_t>(literalValues[this->recordOf(ref).payload]);
+        }
+        double getRealValue(ExprRef ref) const {
+            assert(this->getKind(ref) == ExpressionNodeKind::EXPRESSION_REAL_LITERAL);
+            double value;
+            std::memcpy(&value, &literalValues[this->recordOf(ref).payload], sizeof(value));
+            return value;
+        }
+        BigInteger const &getBigIntegerValue(ExprRef ref) const {
+            assert(this->getKind(ref) == ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL);
+            return bigIntegers[this->recordOf(ref).payload];
+        }
+        NumericValue getLiteralValue(ExprRef ref) const {
+            switch(this->getKind(ref)) {
+            case ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL:
+                return this->getIntegerValue(ref);
+            case ExpressionNodeKind::EXPRESSION_REAL_LITERAL:
+                return this->getRealValue(ref);
+            case ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL:
+                return this->getBigIntegerValue(ref);
+            case ExpressionNodeKind::EXPRESSION_OPERATOR:
+            case ExpressionNodeKind::EXPRESSION_ATOM:
+            case ExpressionNodeKind::LAST_EXPRESSION_NODE:
+            default:
+                throw std::invalid_argument("Expression is not a literal");
+            }
+        }
+        // Only valid for atoms
+        SymbolId getSymbolId(ExprRef ref) const {
+            assert(this->isAtom(ref));
+            return this->recordOf(ref).payload;
+        }
+        std::string const &getSymbol(ExprRef ref) const {
+            return SymbolTable::get().symbolOf(this->getSymbolId(ref));
+        }
+        // Atoms and literals have no operands
+        std::size_t getSize(ExprRef ref) const {
+            return this->getOperands(ref).size();
+        }
+        OperandRange getOperands(ExprRef ref) const {
+            auto const &record = this->recordOf(ref);
+            if(record.operandCount >= firstMarker) {
+                return OperandRange(nullptr, nullptr);
+            }
+            auto const first = operands.data() + record.payload;
+            return OperandRange(first, first + record.operandCount);
+        }
+        // Allows to traverse expressions with traverseTree
+        std::tuple<Iterator, Iterator> getChildrenIterators(ExprRef ref) const {
+            auto const range = this->getOperands(ref);
+            return std::make_tuple(range.begin(), range.end());
+        }
+        // Equal to the hash of the corresponding node
+        IHT::hash_type hash(ExprRef ref) const {
+            return hashes[ref.getIndex()];
+        }
+        // Whether `ref` is the expression of `node`, without converting
+        // either. Shared subexpressions are compared once.
+        bool equals(ExprRef ref, ExpressionNode const *node) const {
+            std::vector<std::pair<ExprRef, ExpressionNode const*>> stack;
+            std::set<std::pair<std::uint32_t, ExpressionNode const*>> compared;
+            stack.emplace_back(ref, node);
+            while(not stack.empty()) {
+                auto const [current, currentNode] = stack.back();
+                stack.pop_back();
+                if(this->hash(current) != currentNode->hash() or this->getKind(current) != currentNode->getKind()) {
+                    return false;
+                }
+                if(not compared.emplace(current.getIndex(), currentNode).second) {
+                    continue;
+                }
+                switch(currentNode->getKind()) {
+                case ExpressionNodeKind::EXPRESSION_ATOM:
+                    if(this->getSymbolId(current) != static_cast<Atom const*>(currentNode)->getSymbolId()) {
+                        return false;
+                    }
+                    break;
+                case ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL:
+                    if(this->getIntegerValue(current) != static_cast<IntegerLiteral const*>(currentNode)->getValue()) {
+                        return false;
+                    }
+                    break;
+                case ExpressionNodeKind::EXPRESSION_REAL_LITERAL: {
+                    // Reals are compared by their representation
+                    auto const value = this->getRealValue(current);
+                    auto const nodeValue = static_cast<RealLiteral const*>(currentNode)->getValue();
+                    if(std::memcmp(&value, &nodeValue, sizeof(value)) != 0) {
+                        return false;
+                    }
+                    break;
+                }
+                case ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL:
+                    if(not (this->getBigIntegerValue(current) == static_cast<BigIntegerLiteral const*>(currentNode)->getValue())) {
+                        return false;
+                    }
+                    break;
+                case ExpressionNodeKind::EXPRESSION_OPERATOR: {
+                    auto const op = static_cast<Operator const*>(currentNode);
+                    auto const range = this->getOperands(current);
+                    if(range.size() != op->getSize()) {
+                        return false;
+                    }
+                    for(std::size_t idx = 0; idx < range.size(); ++idx) {
+                        stack.emplace_back(range[idx], op->getOperands()[idx].get());
+                    }
+                    break;
+                }
+                case ExpressionNodeKind::LAST_EXPRESSION_NODE:
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::string toString(ExprRef ref) const {
+            std::string result;
+            writeExpression(ref, WriterAccess{this}, [&result](std::string_view piece) {
+                result.append(piece);
+            });
+            return result;
+        }
+
+        // Number of distinct expressions held
+        std::size_t size() const {
+            return records.size();
+        }
+        // Bytes allocated by the store, excluding the symbol table
+        std::size_t memoryUsage() const {
+            return records.capacity() * sizeof(Record)
+                 + hashes.capacity() * sizeof(IHT::hash_type)
+                 + operands.capacity() * sizeof(ExprRef)
+                 + slots.capacity() * sizeof(std::uint32_t)
+                 + literalValues.capacity() * sizeof(std::uint64_t)
+                 + std::accumulate(bigIntegers.begin(), bigIntegers.end(), bigIntegers.capacity() * sizeof(BigInteger), [](std::size_t sum, BigInteger const &value) {
+                       return sum + value.getMagnitude().capacity() * sizeof(std::uint32_t);
+                   });
+        }
+
+        // Converts a node to a handle. Shared subexpressions are converted
+        // once; `converted` may be reused across calls.
+        ExprRef intern(ExpressionNodePtr const &node, std::unordered_map<ExpressionNode const*, ExprRef> &converted) {
+            std::vector<ExprRef> buffer;
+            std::vector<std::pair<ExpressionNode const*, bool>> stack;
+            stack.emplace_back(node.get(), false);
+            while(not stack.empty()) {
+                auto const [current, expanded] = stack.back();
+                if(converted.find(current) != converted.end()) {
+                    stack.pop_back();
+                } else if(auto const atom = dyn_cast<Atom>(current); atom != nullptr) {
+                    converted.emplace(current, this->makeAtom(atom->getSymbolId()));
+                    stack.pop_back();
+                } else if(auto const value = getNumericValue(current); value.has_value()) {
+                    converted.emplace(current, this->makeLiteral(value.value()));
+                    stack.pop_back();
+                } else if(not expanded) {
+                    stack.back().second = true;
+                    for(auto const &operand : *static_cast<Operator const*>(current)) {
+                        if(converted.find(operand.get()) == converted.end()) {
+                            stack.emplace_back(operand.get(), false);
+                        }
+                    }
+                } else {
+                    buffer.clear();
+                    for(auto const &operand : *static_cast<Operator const*>(current)) {
+                        buffer.push_back(converted.at(operand.get()));
+                    }
+                    converted.emplace(current, this->makeExpression(buffer.data(), buffer.size()));
+                    stack.pop_back();
+                }
+            }
+            return converted.at(node.get());
+        }
+        ExprRef intern(ExpressionNodePtr const &node) {
+            std::unordered_map<ExpressionNode const*, ExprRef> converted;
+            return this->intern(node, converted);
+        }
+
+        // Converts a handle to a node of `factory`. Shared subexpressions are
+        // converted once; `converted` maps indices of handles to nodes and
+        // may be reused across calls with the same factory.
+        ExpressionNodePtr materialize(ExprRef ref, ExpressionFactory &factory, std::unordered_map<std::uint32_t, ExpressionNodePtr> &converted) const {
+            std::vector<std::pair<ExprRef, bool>> stack;
+            stack.emplace_back(ref, false);
+            while(not stack.empty()) {
+                auto const [current, expanded] = stack.back();
+                if(converted.find(current.getIndex()) != converted.end()) {
+                    stack.pop_back();
+                } else if(this->isAtom(current)) {
+                    converted.emplace(current.getIndex(), factory.makeIdentifier(this->getSymbol(current)));
+                    stack.pop_back();
+                } else if(this->isLiteral(current)) {
+                    converted.emplace(current.getIndex(), factory.makeLiteral(this->getLiteralValue(current)));
+                    stack.pop_back();
+                } else if(not expanded) {
+                    stack.back().second = true;
+                    for(auto const operand : this->getOperands(current)) {
+                        if(converted.find(operand.getIndex()) == converted.end()) {
+                            stack.emplace_back(operand, false);
+                        }
+                    }
+                } else {
+                    std::vector<ExpressionNodePtr> nodes;
+                    nodes.reserve(this->getSize(current));
+                    for(auto const operand : this->getOperands(current)) {
+                        nodes.push_back(converted.at(operand.getIndex()));
+                    }
+                    converted.emplace(current.getIndex(), factory.makeExpression(std::move(nodes)));
+                    stack.pop_back();
+                }
+            }
+            return converted.at(ref.getIndex());
+        }
+        ExpressionNodePtr materialize(ExprRef ref, ExpressionFactory &factory) const {
+            std::unordered_map<std::uint32_t, ExpressionNodePtr> converted;
+            return this->materialize(ref, factory, converted);
+        }
+        // Converts many handles to nodes of `factory` at once. The
+        // expressions they refer to are made level by level with the bulk
+        // operations of ExpressionFactory, using `executor` for every level.
+        // Returns the nodes in the order of `refs`.
+        template<typename Executor = IHT::SequentialExecutor>
+        std::vector<ExpressionNodePtr> materialize(std::vector<ExprRef> const &refs, ExpressionFactory &factory, Executor &&executor = Executor()) const {
+            // Only the expressions reachable from `refs` are visited, in
+            // post-order, so operands are numbered before their operators and
+            // the work is proportional to the expressions converted rather
+            // than to the size of the store. `positions` maps the index of a
+            // handle to its number.
+            std::unordered_map<std::uint32_t, std::uint32_t> positions;
+            std::vector<std::uint32_t> reachable;
+            std::vector<std::uint32_t> heights;
+            std::vector<std::vector<std::uint32_t>> levels;
+            std::vector<std::pair<ExprRef, bool>> stack;
+            for(auto const root : refs) {
+                stack.emplace_back(root, false);
+                while(not stack.empty()) {
+                    auto const [current, expanded] = stack.back();
+                    if(positions.find(current.getIndex()) != positions.end()) {
+                        stack.pop_back();
+                    } else if(not expanded) {
+                        stack.back().second = true;
+                        for(auto const operand : this->getOperands(current)) {
+                            if(positions.find(operand.getIndex()) == positions.end()) {
+                                stack.emplace_back(operand, false);
+                            }
+                        }
+                    } else {
+                        stack.pop_back();
+                        std::uint32_t height = 0;
+                        if(not this->isAtom(current) and not this->isLiteral(current)) {
+                            height = 1;
+                            for(auto const operand : this->getOperands(current)) {
+                                height = std::max(height, heights[positions.at(operand.getIndex())] + 1u);
+                            }
+                        }
+                        auto const position = static_cast<std::uint32_t>(reachable.size());
+                        positions.emplace(current.getIndex(), position);
+                        reachable.push_back(current.getIndex());
+                        heights.push_back(height);
+                        if(levels.size() <= height) {
+                            levels.resize(height + 1u);
+                        }
+                        levels[height].push_back(position);
+                    }
+                }
+            }
+
+            std::vector<ExpressionNodePtr> nodes(reachable.size());
+            if(not levels.empty()) {
+                std::vector<std::uint32_t> atoms, literals;
+                std::vector<std::string_view> symbols;
+                std::vector<NumericValue> values;
+                for(auto const position : levels.front()) {
+                    auto const ref = ExprRef(reachable[position]);
+                    if(this->isAtom(ref)) {
+                        atoms.push_back(position);
+                        symbols.emplace_back(this->getSymbol(ref));
+                    } else {
+                        literals.push_back(position);
+                        values.push_back(this->getLiteralValue(ref));
+                    }
+                }
+                auto const atomNodes = factory.makeIdentifiers(symbols, executor);
+                for(std::size_t idx = 0; idx < atoms.size(); ++idx) {
+                    nodes[atoms[idx]] = atomNodes[idx];
+                }
+                auto const literalNodes = factory.makeLiterals(values, executor);
+                for(std::size_t idx = 0; idx < literals.size(); ++idx) {
+                    nodes[literals[idx]] = literalNodes[idx];
+                }
+            }
+            std::vector<ExpressionNodePtr> operandNodes;
+            std::vector<libexpressions::OperandRange> batch;
+            for(std::size_t height = 1; height < levels.size(); ++height) {
+                operandNodes.clear();
+                batch.clear();
+                for(auto const position : levels[height]) {
+                    for(auto const operand : this->getOperands(ExprRef(reachable[position]))) {
+                        operandNodes.push_back(nodes[positions.at(operand.getIndex())]);
+                    }
+                }
+                std::size_t offset = 0;
+                for(auto const position : levels[height]) {
+                    auto const count = this->getSize(ExprRef(reachable[position]));
+                    batch.emplace_back(operandNodes.data() + offset, count);
+                    offset += count;
+                }
+                auto const operatorNodes = factory.makeExpressions(batch, executor);
+                for(std::size_t idx = 0; idx < levels[height].size(); ++idx) {
+                    nodes[levels[height][idx]] = operatorNodes[idx];
+                }
+            }
+
+            std::vector<ExpressionNodePtr> result;
+            result.reserve(refs.size());
+            for(auto const ref : refs) {
+                result.push_back(nodes[positions.at(ref.getIndex())]);
+            }
+            return result;
+        }
+    };
+}
@@ -27,14 +27,26 @@
 
 #include "libexpressions/expressions/atom.hpp"
 #include "libexpressions/expressions/operator.hpp"
+#include "libexpressions/expressions/literal.hpp"
 #include "libexpressions/expressions/expression_node_kind.hpp"
 
 namespace libexpressions {
+    // Casts based on the kind of a node, which identifies its type without
+    // consulting RTTI
+    template<typename T, typename Node>
+    bool isa(Node const *node) {
+        return T::classof(node);
+    }
+    template<typename T, typename Node>
+    T const *dyn_cast(Node const *node) {
+        return T::classof(node) ? static_cast<T const*>(node) : nullptr;
+    }
+
     template<typename T, typename Fn, typename Node>
     auto cast_and_call(Fn &&f, Node const *node)
     -> std::result_of_t<Fn(T const*)> {
-        assert(dynamic_cast<T const*>(node) != nullptr);
-        return f(dynamic_cast<T const*>(node));
+        assert(T::classof(node));
+        return f(static_cast<T const*>(node));
     }
 
     // This function shall determine the Kind of the Node given as the first
@@ -45,7 +57,10 @@ namespace libexpressions {
       -> std::result_of_t<Fn(libexpressions::Operator const *)> {
         auto kind = node->getKind();
         assert(kind == libexpressions::ExpressionNodeKind::EXPRESSION_OPERATOR or
-                kind == libexpressions::ExpressionNodeKind::EXPRESSION_ATOM);
+                kind == libexpressions::ExpressionNodeKind::EXPRESSION_ATOM or
+                kind == libexpressions::ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL or
+                kind == libexpressions::ExpressionNodeKind::EXPRESSION_REAL_LITERAL or
+                kind == libexpressions::ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL);
         switch(kind) {
         case libexpressions::ExpressionNodeKind::EXPRESSION_OPERATOR:
             return cast_and_call<typename libexpressions::Operator, Fn, libexpressions::ExpressionNode>(std::forward<Fn>(f), node);
@@ -53,6 +68,15 @@ namespace libexpressions {
         case libexpressions::ExpressionNodeKind::EXPRESSION_ATOM:
             return cast_and_call<typename libexpressions::Atom, Fn, libexpressions::ExpressionNode>(std::forward<Fn>(f), node);
             break;
+        case libexpressions::ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL:
+            return cast_and_call<typename libexpressions::IntegerLiteral, Fn, libexpressions::ExpressionNode>(std::forward<Fn>(f), node);
+            break;
+        case libexpressions::ExpressionNodeKind::EXPRESSION_REAL_LITERAL:
+            return cast_and_call<typename libexpressions::RealLiteral, Fn, libexpressions::ExpressionNode>(std::forward<Fn>(f), node);
+            break;
+        case libexpressions::ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL:
+            return cast_and_call<typename libexpressions::BigIntegerLiteral, Fn, libexpressions::ExpressionNode>(std::forward<Fn>(f), node);
+            break;
         case libexpressions::ExpressionNodeKind::LAST_EXPRESSION_NODE:
         default:
             throw std::runtime_error("Visiting an object of invalid type");
@@ -33,6 +33,8 @@ namespace libexpressions {
     class ExpressionNode;
     class Atom;
     class Operator;
+    template<typename ValueType, ExpressionNodeKind literalKind>
+    class Literal;
 
     class ExpressionVisitor {
     public:
@@ -40,6 +42,8 @@ namespace libexpressions {
         void visit(libexpressions::ExpressionNode const &)  { };
         void visit(libexpressions::Atom const &)            { };
         void visit(libexpressions::Operator const &)        { };
+        template<typename ValueType, ExpressionNodeKind literalKind>
+        void visit(libexpressions::Literal<ValueType, literalKind> const &) { }
     };
 }
 
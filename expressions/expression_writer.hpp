@@ -0,0 +1,182 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "libexpressions/expressions/expression_node.hpp"
+#include "libexpressions/expressions/expression_visit_helper.hpp"
+#include "libexpressions/expressions/numeric_value.hpp"
+
+namespace libexpressions {
+    // Writes the textual representation of a numeric literal to `sink`
+    template<typename Sink>
+    void writeNumericValue(NumericValue const &value, Sink &sink) {
+        if(auto const integer = std::get_if<std::int64_t>(&value); integer != nullptr) {
+            char digits[24];
+            auto const end = std::to_chars(digits, digits + sizeof(digits), *integer).ptr;
+            sink(std::string_view(digits, static_cast<std::size_t>(end - digits)));
+        } else {
+            sink(std::string_view(numericValueToString(value)));
+        }
+    }
+
+    // Writes the textual representation of an expression in a single pass
+    // without recursion. The expression is given by its root `node` of any
+    // type and by `access`, which provides
+    // - `bool isOperator(Node) const`,
+    // - `std::size_t getSize(Node) const` and `Node getOperand(Node,
+    //   std::size_t) const` for operators, and
+    // - `void writeLeaf(Node, Sink &) const` for atoms and literals.
+    // `sink` is called with consecutive pieces of the text, such as a
+    // parenthesis or the symbol of an atom, as std::string_view. Shared
+    // subexpressions are written each time they occur.
+    template<typename Node, typename Access, typename Sink, typename = std::enable_if_t<std::is_invocable_v<Sink&, std::string_view>>>
+    void writeExpression(Node const &node, Access const &access, Sink &&sink) {
+        // Operators being written and the index of their next operand
+        std::vector<std::pair<Node, std::size_t>> stack;
+        Node next = node;
+        bool hasNext = true;
+        while(true) {
+            if(hasNext) {
+                if(access.isOperator(next)) {
+                    sink(std::string_view("("));
+                    stack.emplace_back(next, 0);
+                } else {
+                    access.writeLeaf(next, sink);
+                }
+                hasNext = false;
+            }
+            if(stack.empty()) {
+                break;
+            }
+            auto &[op, operandIdx] = stack.back();
+            if(operandIdx == access.getSize(op)) {
+                sink(std::string_view(")"));
+                stack.pop_back();
+            } else {
+                if(operandIdx > 0) {
+                    sink(std::string_view(" "));
+                }
+                next = access.getOperand(op, operandIdx++);
+                hasNext = true;
+            }
+        }
+    }
+
+    // Access to expression nodes for writeExpression
+    struct ExpressionNodeWriterAccess {
+        bool isOperator(ExpressionNode const *node) const {
+            return isa<Operator>(node);
+        }
+        std::size_t getSize(ExpressionNode const *node) const {
+            return static_cast<Operator const *>(node)->getSize();
+        }
+        ExpressionNode const *getOperand(ExpressionNode const *node, std::size_t idx) const {
+            return static_cast<Operator const *>(node)->getOperands()[idx].get();
+        }
+        template<typename Sink>
+        void writeLeaf(ExpressionNode const *node, Sink &sink) const {
+            if(auto const atom = dyn_cast<Atom>(node); atom != nullptr) {
+                sink(std::string_view(atom->getSymbol()));
+            } else if(auto const value = getNumericValue(node); value.has_value()) {
+                writeNumericValue(value.value(), sink);
+            }
+        }
+    };
+
+    template<typename Sink, typename = std::enable_if_t<std::is_invocable_v<Sink&, std::string_view>>>
+    void writeExpression(ExpressionNode const *node, Sink &&sink) {
+        writeExpression(node, ExpressionNodeWriterAccess{}, sink);
+    }
+
+    // Like writeExpression, but collects the text in a buffer and passes it
+    // to `sink` in chunks of `chunkSize` characters; only the last chunk
+    // may be shorter.
+    template<typename Sink>
+    void writeExpressionChunked(ExpressionNode const *node, Sink &&sink, std::size_t chunkSize = 4096u) {
+        std::string buffer;
+        chunkSize = std::max<std::size_t>(chunkSize, 1u);
+        buffer.reserve(chunkSize);
+        writeExpression(node, [&buffer,&sink,chunkSize](std::string_view piece) {
+            while(buffer.size() + piece.size() >= chunkSize) {
+                auto const fill = chunkSize - buffer.size();
+                buffer.append(piece.substr(0, fill));
+                piece.remove_prefix(fill);
+                sink(std::string_view(buffer));
+                buffer.clear();
+            }
+            buffer.append(piece);
+        });
+        if(not buffer.empty()) {
+            sink(std::string_view(buffer));
+        }
+    }
+
+    inline void writeExpression(ExpressionNode const *node, std::ostream &stream) {
+        writeExpressionChunked(node, [&stream](std::string_view chunk) {
+            stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        });
+    }
+
+    // Writes at most `capacity` characters of the text to `buffer` without
+    // terminating it and returns the length of the whole text. The text has
+    // been truncated if the result exceeds `capacity`.
+    inline std::size_t writeExpression(ExpressionNode const *node, char *buffer, std::size_t capacity) {
+        std::size_t length = 0;
+        writeExpression(node, [buffer,capacity,&length](std::string_view piece) {
+            if(length < capacity) {
+                piece.copy(buffer + length, std::min(piece.size(), capacity - length));
+            }
+            length += piece.size();
+        });
+        return length;
+    }
+
+    // Exact length of the text of an expression, e.g. to size a buffer
+    inline std::size_t expressionTextLength(ExpressionNode const *node) {
+        std::size_t length = 0;
+        writeExpression(node, [&length](std::string_view piece) {
+            length += piece.size();
+        });
+        return length;
+    }
+
+    inline std::string expressionToString(ExpressionNode const *node) {
+        std::string result;
+        writeExpression(node, [&result](std::string_view piece) {
+            result.append(piece);
+        });
+        return result;
+    }
+}
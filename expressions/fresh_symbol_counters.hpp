@@ -0,0 +1,78 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace libexpressions {
+    // Hands out suffixes for fresh symbols. Every prefix has a counter of
+    // its own, so the suffixes handed out for a prefix are distinct and
+    // increase monotonically, independently of other prefixes. Counters are
+    // spread over several shards, each guarded by its own mutex.
+    class FreshSymbolCounters {
+    private:
+        static constexpr std::size_t shardCount = 16;
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::size_t> nextSuffixes;
+        };
+
+        std::array<Shard, shardCount> shards;
+    public:
+        FreshSymbolCounters() = default;
+        FreshSymbolCounters(FreshSymbolCounters const &) = delete;
+        FreshSymbolCounters &operator=(FreshSymbolCounters const &) = delete;
+
+        // Reserves `count` consecutive suffixes for `prefix` and returns the
+        // first of them
+        std::size_t reserve(std::string const &prefix, std::size_t count = 1) {
+            auto &shard = shards[std::hash<std::string_view>{}(prefix) % shardCount];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto &next = shard.nextSuffixes[prefix];
+            if(count > std::numeric_limits<std::size_t>::max() - next) {
+                throw std::length_error("Too many fresh symbols");
+            }
+            auto const first = next;
+            next += count;
+            return first;
+        }
+
+        // The symbol with the given prefix and suffix, e.g. `x_7`
+        static std::string symbolOf(std::string const &prefix, std::size_t suffix) {
+            auto const digits = std::to_string(suffix);
+            std::string result;
+            result.reserve(prefix.size() + 1u + digits.size());
+            result.append(prefix).append(1, '_').append(digits);
+            return result;
+        }
+    };
+}
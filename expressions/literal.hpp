@@ -0,0 +1,157 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "libexpressions/expressions/expression_node.hpp"
+#include "libexpressions/expressions/expression_hash.hpp"
+#include "libexpressions/expressions/numeric_value.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace libexpressions {
+    // Numeric literals store their value in the node and are hash-consed by
+    // value. Reals are compared by their representation, so that every real
+    // including NaN is equal to itself and 0.0 differs from -0.0. The limbs
+    // of big integers are stored out of line.
+    template<typename ValueType, ExpressionNodeKind literalKind>
+    class Literal final : public ExpressionNode {
+        friend class IHT::IHTFactory<ExpressionNode>;
+    private:
+        ValueType const value;
+        IHT::hash_type const hashValue;
+
+        static bool sameValue(ValueType const &lhs, ValueType const &rhs) {
+            if constexpr(std::is_same_v<ValueType, double>) {
+                return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+            } else {
+                return lhs == rhs;
+            }
+        }
+    protected:
+        Literal(ValueType paramValue)
+            : ExpressionNode(literalKind),
+              value(std::move(paramValue)),
+              hashValue(Literal::hashOf(value)) {}
+        // Used when the hash has already been computed for a lookup key
+        Literal(ValueType paramValue, IHT::hash_type paramHash)
+            : ExpressionNode(literalKind),
+              value(std::move(paramValue)),
+              hashValue(paramHash) {}
+    public:
+        typedef ValueType value_type;
+
+        // Lookup key for IHT::IHTFactory::createNodeWithKey, identifying a
+        // literal by its value without constructing it.
+        class Key {
+        private:
+            ValueType const &value;
+            IHT::hash_type const hashValue;
+        public:
+            explicit Key(ValueType const &paramValue)
+                : value(paramValue),
+                  hashValue(Literal::hashOf(paramValue)) {}
+
+            IHT::hash_type hash() const {
+                return hashValue;
+            }
+            bool equal_to(ExpressionNode const *node) const {
+                return Literal::classof(node) and Literal::sameValue(static_cast<Literal const *>(node)->value, value);
+            }
+        };
+
+        virtual ~Literal() = default;
+
+        static IHT::hash_type hashOf(ValueType const &value) {
+            return ExpressionHashPolicy::hashLiteral(value);
+        }
+
+        ValueType const &getValue() const {
+            return value;
+        }
+
+        IHT::hash_type hash() const {
+            return hashValue;
+        }
+
+        std::string toString() const {
+            return numericValueToString(value);
+        }
+
+        std::uint32_t getDepth() const {
+            return 1;
+        }
+        std::uint64_t getTreeSize() const {
+            return 1;
+        }
+        DagSizeSketch getDagSizeSketch() const {
+            return DagSizeSketch::of(this->hash());
+        }
+        // Literals contain no symbols
+        SymbolSignature getSymbolSignature() const {
+            return SymbolSignature();
+        }
+
+        std::size_t memoryFootprint() const {
+            if constexpr(std::is_same_v<ValueType, BigInteger>) {
+                return sizeof(Literal) + value.getMagnitude().capacity() * sizeof(std::uint32_t);
+            } else {
+                return sizeof(Literal);
+            }
+        }
+
+        bool equal_to(ExpressionNode const *other) const {
+            return Literal::classof(other) and Literal::sameValue(static_cast<Literal const *>(other)->value, value);
+        }
+        static constexpr bool classof(ExpressionNode const *node) {
+            return node->getKind() == literalKind;
+        }
+    };
+
+    typedef Literal<std::int64_t, ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL> IntegerLiteral;
+    typedef Literal<double, ExpressionNodeKind::EXPRESSION_REAL_LITERAL> RealLiteral;
+    // Only used for integers that do not fit into 64 bits
+    typedef Literal<BigInteger, ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL> BigIntegerLiteral;
+
+    // Value of a numeric literal node, or nothing if the node is not a
+    // literal
+    inline std::optional<NumericValue> getNumericValue(ExpressionNode const *node) {
+        switch(node->getKind()) {
+        case ExpressionNodeKind::EXPRESSION_INTEGER_LITERAL:
+            return NumericValue(static_cast<IntegerLiteral const *>(node)->getValue());
+        case ExpressionNodeKind::EXPRESSION_REAL_LITERAL:
+            return NumericValue(static_cast<RealLiteral const *>(node)->getValue());
+        case ExpressionNodeKind::EXPRESSION_BIG_INTEGER_LITERAL:
+            return NumericValue(static_cast<BigIntegerLiteral const *>(node)->getValue());
+        case ExpressionNodeKind::EXPRESSION_OPERATOR:
+        case ExpressionNodeKind::EXPRESSION_ATOM:
+        case ExpressionNodeKind::LAST_EXPRESSION_NODE:
+        default:
+            return std::nullopt;
+        }
+    }
+}
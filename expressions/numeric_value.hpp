@@ -0,0 +1,260 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+namespace libexpressions {
+    // Integer of arbitrary length, stored as sign and magnitude. The
+    // magnitude is kept in 32-bit limbs, least significant limb first and
+    // without leading zero limbs, so every value has a unique
+    // representation.
+    class BigInteger {
+    private:
+        bool negative = false;
+        std::vector<std::uint32_t> magnitude;
+
+        void trim() {
+            while(not magnitude.empty() and magnitude.back() == 0) {
+                magnitude.pop_back();
+            }
+            if(magnitude.empty()) {
+                negative = false;
+            }
+        }
+        // magnitude = magnitude * factor + summand
+        void multiplyAdd(std::uint32_t factor, std::uint32_t summand) {
+            std::uint64_t carry = summand;
+            for(auto &limb : magnitude) {
+                auto const product = static_cast<std::uint64_t>(limb) * factor + carry;
+                limb = static_cast<std::uint32_t>(product);
+                carry = product >> 32u;
+            }
+            if(carry != 0) {
+                magnitude.push_back(static_cast<std::uint32_t>(carry));
+            }
+        }
+        // magnitude = magnitude / divisor, returning the remainder
+        std::uint32_t divide(std::uint32_t divisor) {
+            std::uint64_t remainder = 0;
+            for(auto limb = magnitude.rbegin(); limb != magnitude.rend(); ++limb) {
+                auto const current = (remainder << 32u) | *limb;
+                *limb = static_cast<std::uint32_t>(current / divisor);
+                remainder = current % divisor;
+            }
+            this->trim();
+            return static_cast<std::uint32_t>(remainder);
+        }
+    public:
+        BigInteger() = default;
+        explicit BigInteger(std::int64_t value) : negative(value < 0) {
+            // Negating the smallest value in 64 bits overflows
+            auto absolute = negative ? ~static_cast<std::uint64_t>(value) + 1u : static_cast<std::uint64_t>(value);
+            while(absolute != 0) {
+                magnitude.push_back(static_cast<std::uint32_t>(absolute));
+                absolute >>= 32u;
+            }
+        }
+
+        // Accepts decimal digits with an optional sign
+        static std::optional<BigInteger> fromString(std::string_view text) {
+            BigInteger result;
+            bool const negative = not text.empty() and text.front() == '-';
+            if(not text.empty() and (text.front() == '-' or text.front() == '+')) {
+                text.remove_prefix(1);
+            }
+            if(text.empty()) {
+                return std::nullopt;
+            }
+            // Digits are consumed in chunks of up to nine, which fit a limb
+            while(not text.empty()) {
+                auto const chunkLength = std::min<std::size_t>(text.size(), 9u);
+                std::uint32_t chunk = 0;
+                std::uint32_t scale = 1;
+                for(std::size_t idx = 0; idx < chunkLength; ++idx) {
+                    if(text[idx] < '0' or text[idx] > '9') {
+                        return std::nullopt;
+                    }
+                    chunk = chunk * 10u + static_cast<std::uint32_t>(text[idx] - '0');
+                    scale *= 10u;
+                }
+                result.multiplyAdd(scale, chunk);
+                text.remove_prefix(chunkLength);
+            }
+            result.negative = negative;
+            result.trim();
+            return result;
+        }
+
+        bool isNegative() const {
+            return negative;
+        }
+        std::vector<std::uint32_t> const &getMagnitude() const {
+            return magnitude;
+        }
+
+        bool fitsInt64() const {
+            if(magnitude.size() > 2u) {
+                return false;
+            }
+            std::uint64_t absolute = 0;
+            for(auto limb = magnitude.rbegin(); limb != magnitude.rend(); ++limb) {
+                absolute = (absolute << 32u) | *limb;
+            }
+            auto const limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+            return absolute <= limit + (negative ? 1u : 0u);
+        }
+        // Requires fitsInt64()
+        std::int64_t toInt64() const {
+            std::uint64_t absolute = 0;
+            for(auto limb = magnitude.rbegin(); limb != magnitude.rend(); ++limb) {
+                absolute = (absolute << 32u) | *limb;
+            }
+            return static_cast<std::int64_t>(negative ? ~absolute + 1u : absolute);
+        }
+
+        std::string toString() const {
+            if(magnitude.empty()) {
+                return "0";
+            }
+            BigInteger remaining = *this;
+            std::vector<std::uint32_t> chunks;
+            while(not remaining.magnitude.empty()) {
+                chunks.push_back(remaining.divide(1000000000u));
+            }
+            std::string result = negative ? "-" : "";
+            result += std::to_string(chunks.back());
+            for(auto chunk = chunks.rbegin() + 1; chunk != chunks.rend(); ++chunk) {
+                auto const digits = std::to_string(*chunk);
+                result.append(9u - digits.size(), '0');
+                result += digits;
+            }
+            return result;
+        }
+
+        friend bool operator==(BigInteger const &lhs, BigInteger const &rhs) {
+            return lhs.negative == rhs.negative and lhs.magnitude == rhs.magnitude;
+        }
+        friend bool operator!=(BigInteger const &lhs, BigInteger const &rhs) {
+            return not (lhs == rhs);
+        }
+    };
+
+    // Value of a numeric literal
+    typedef std::variant<std::int64_t, double, BigInteger> NumericValue;
+
+    // Reals are printed such that they are read back as reals
+    inline std::string numericValueToString(std::int64_t value) {
+        return std::to_string(value);
+    }
+    inline std::string numericValueToString(double value) {
+        char buffer[32];
+        auto const [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        std::string result(buffer, error == std::errc() ? end : buffer);
+        if(result.find_first_of(".ein") == std::string::npos) {
+            result += ".0";
+        }
+        return result;
+    }
+    inline std::string numericValueToString(BigInteger const &value) {
+        return value.toString();
+    }
+    inline std::string numericValueToString(NumericValue const &value) {
+        return std::visit([](auto const &alternative) {
+            return numericValueToString(alternative);
+        }, value);
+    }
+
+    // Recognises integers, i.e. decimal digits with an optional sign, and
+    // reals in decimal notation with a fractional part, an exponent or
+    // both. Integers that do not fit into 64 bits become BigIntegers. Reals
+    // that are out of range of a double are not recognised.
+    inline std::optional<NumericValue> parseNumericLiteral(std::string_view text) {
+        std::size_t pos = 0;
+        auto const digitsAt = [&text](std::size_t start) {
+            auto end = start;
+            while(end < text.size() and text[end] >= '0' and text[end] <= '9') {
+                ++end;
+            }
+            return end - start;
+        };
+        if(pos < text.size() and (text[pos] == '+' or text[pos] == '-')) {
+            ++pos;
+        }
+        auto const integralDigits = digitsAt(pos);
+        pos += integralDigits;
+        std::size_t fractionalDigits = 0;
+        bool real = false;
+        if(pos < text.size() and text[pos] == '.') {
+            real = true;
+            ++pos;
+            fractionalDigits = digitsAt(pos);
+            pos += fractionalDigits;
+        }
+        if(integralDigits + fractionalDigits == 0) {
+            return std::nullopt;
+        }
+        if(pos < text.size() and (text[pos] == 'e' or text[pos] == 'E')) {
+            real = true;
+            ++pos;
+            if(pos < text.size() and (text[pos] == '+' or text[pos] == '-')) {
+                ++pos;
+            }
+            auto const exponentDigits = digitsAt(pos);
+            if(exponentDigits == 0) {
+                return std::nullopt;
+            }
+            pos += exponentDigits;
+        }
+        if(pos != text.size()) {
+            return std::nullopt;
+        }
+        // from_chars does not accept a leading plus
+        if(text.front() == '+') {
+            text.remove_prefix(1);
+        }
+        if(real) {
+            double value = 0.0;
+            auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(error != std::errc() or end != text.data() + text.size()) {
+                return std::nullopt;
+            }
+            return NumericValue(value);
+        }
+        std::int64_t value = 0;
+        auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if(error == std::errc() and end == text.data() + text.size()) {
+            return NumericValue(value);
+        }
+        return NumericValue(BigInteger::fromString(text).value());
+    }
+}
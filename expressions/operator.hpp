@@ -22,80 +22,245 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <vector>
 #include <iterator>
+#include <limits>
 
 #include "libexpressions/expressions/expression_node.hpp"
+#include "libexpressions/expressions/expression_hash.hpp"
 #include "libexpressions/iht/iht_factory.hpp"
 
 namespace libexpressions {
     typedef std::vector<ExpressionNodePtr> OperandContainer;
 
+    // A view of the operands of an operator
+    class OperandRange {
+    private:
+        ExpressionNodePtr const *first;
+        std::size_t count;
+    public:
+        typedef ExpressionNodePtr value_type;
+        typedef ExpressionNodePtr const *const_iterator;
+        typedef const_iterator iterator;
+
+        OperandRange(ExpressionNodePtr const *paramFirst, std::size_t paramCount)
+            : first(paramFirst), count(paramCount) {}
+
+        const_iterator begin() const {
+            return first;
+        }
+        const_iterator end() const {
+            return first + count;
+        }
+        std::size_t size() const {
+            return count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        ExpressionNodePtr const *data() const {
+            return first;
+        }
+        ExpressionNodePtr const &operator[](std::size_t idx) const {
+            return first[idx];
+        }
+        ExpressionNodePtr const &at(std::size_t idx) const {
+            if(idx >= count) {
+                throw std::out_of_range("Operand index out of range");
+            }
+            return first[idx];
+        }
+        ExpressionNodePtr const &front() const {
+            return first[0];
+        }
+        ExpressionNodePtr const &back() const {
+            return first[count - 1u];
+        }
+    };
+
     //Associativity to be defined by the application/theory
+    //The operands are stored directly behind the operator in the same
+    //allocation, so operators can only be created by IHT::IHTFactory.
     class Operator final : public ExpressionNode {
         friend class IHT::IHTFactory<ExpressionNode>;
     public:
         typedef libexpressions::OperandContainer OperandContainer;
-        typedef OperandContainer::const_iterator Iterator;
+        typedef OperandRange::const_iterator Iterator;
         typedef size_t PathElement;
         typedef std::vector<PathElement> Path;
     private:
-        OperandContainer const operands;
+        // Both fit into the padding behind ExpressionNode
+        std::uint32_t depth;
+        std::uint32_t const operandCount;
         IHT::hash_type const hashCache;
+        std::uint64_t treeSize;
+        DagSizeSketch dagSizeSketch;
+        SymbolSignature symbolSignature;
+
+        ExpressionNodePtr *operandStorage() {
+            return reinterpret_cast<ExpressionNodePtr*>(this + 1);
+        }
+        ExpressionNodePtr const *operandStorage() const {
+            return reinterpret_cast<ExpressionNodePtr const*>(this + 1);
+        }
+        static_assert(alignof(ExpressionNodePtr) <= alignof(ExpressionNode), "Operands have to be suitably aligned behind operators.");
+        static std::uint32_t checkedOperandCount(std::size_t count) {
+            if(count > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("Too many operands");
+            }
+            return static_cast<std::uint32_t>(count);
+        }
+
+        // Leaves the operands to be placed by the delegating constructor
+        Operator(std::size_t count, IHT::hash_type paramHash)
+            : ExpressionNode(ExpressionNodeKind::EXPRESSION_OPERATOR),
+              depth(1),
+              operandCount(Operator::checkedOperandCount(count)),
+              hashCache(paramHash),
+              treeSize(1),
+              dagSizeSketch(DagSizeSketch::of(paramHash)) { }
+        void placeOperand(std::size_t idx, ExpressionNodePtr &&operand) {
+            auto const placed = ::new(this->operandStorage() + idx) ExpressionNodePtr(std::move(operand));
+            depth = std::max(depth, (*placed)->getDepth() + 1u);
+            treeSize = saturatingAdd(treeSize, (*placed)->getTreeSize());
+            dagSizeSketch = dagSizeSketch.merged((*placed)->getDagSizeSketch());
+            symbolSignature = symbolSignature.merged((*placed)->getSymbolSignature());
+        }
     protected:
         Operator(OperandContainer &&paramOperands)
-            : ExpressionNode(ExpressionNodeKind::EXPRESSION_OPERATOR),
-              operands(std::move(paramOperands)),
-              hashCache([this]() {
-                  size_t result = 0;
-                  size_t maxLowestByte = result & 0xFFu;
-                  for(auto const &operand : this->operands) {
-                      size_t opHash = operand->hash();
-                      result ^= opHash;
-                      maxLowestByte = std::max(maxLowestByte, opHash & 0xFFu);
-                  }
-                  result = (result & ~0xFFu) | ((maxLowestByte + 1) & 0xFFu);
-                  return result;
-              }()) { }
+            : Operator(std::move(paramOperands), Operator::hashOf(paramOperands.data(), paramOperands.size())) { }
+        // Used when the hash has already been computed for a lookup key
+        Operator(OperandContainer &&paramOperands, IHT::hash_type paramHash)
+            : Operator(paramOperands.size(), paramHash) {
+            for(std::size_t i = 0; i < operandCount; ++i) {
+                this->placeOperand(i, std::move(paramOperands[i]));
+            }
+        }
+        // Copies the operands
+        Operator(ExpressionNodePtr const *paramFirst, std::size_t paramCount, IHT::hash_type paramHash)
+            : Operator(paramCount, paramHash) {
+            for(std::size_t i = 0; i < operandCount; ++i) {
+                this->placeOperand(i, ExpressionNodePtr(paramFirst[i]));
+            }
+        }
+        Operator(Operator const &) = delete;
+        Operator &operator=(Operator const &) = delete;
+
+        // Number of bytes occupied by an operator together with its operands
+        static std::size_t allocationSizeFor(std::size_t count) {
+            return sizeof(Operator) + count * sizeof(ExpressionNodePtr);
+        }
+        template<typename ...Args>
+        static std::size_t allocationSizeFor(OperandContainer const &paramOperands, Args const &...) {
+            return Operator::allocationSizeFor(paramOperands.size());
+        }
+        template<typename ...Args>
+        static std::size_t allocationSizeFor(ExpressionNodePtr const *, std::size_t count, Args const &...) {
+            return Operator::allocationSizeFor(count);
+        }
+        std::size_t allocationSize() const {
+            return Operator::allocationSizeFor(operandCount);
+        }
     public:
-        virtual ~Operator() = default;
+        // Lookup key for IHT::IHTFactory::createNodeWithKey, identifying an
+        // operator by a sequence of operands without constructing it. The
+        // operands have to outlive the key.
+        class Key {
+        private:
+            ExpressionNodePtr const *const first;
+            std::size_t const count;
+            IHT::hash_type const hashValue;
+        public:
+            Key(ExpressionNodePtr const *paramFirst, std::size_t paramCount)
+                : first(paramFirst),
+                  count(paramCount),
+                  hashValue(Operator::hashOf(paramFirst, paramCount)) {}
+            explicit Key(OperandContainer const &paramOperands)
+                : Key(paramOperands.data(), paramOperands.size()) {}
+
+            IHT::hash_type hash() const {
+                return hashValue;
+            }
+            bool equal_to(ExpressionNode const *node) const {
+                if(not Operator::classof(node)) {
+                    return false;
+                }
+                auto const otherOperands = static_cast<Operator const *>(node)->getOperands();
+                if(otherOperands.size() != count) {
+                    return false;
+                }
+                for(std::size_t i = 0; i < count; ++i) {
+                    if(not first[i]->equal_to(otherOperands[i].get())) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        virtual ~Operator() {
+            auto const storage = this->operandStorage();
+            for(std::size_t i = operandCount; i > 0; --i) {
+                storage[i - 1u].~ExpressionNodePtr();
+            }
+        }
+
+        static IHT::hash_type hashOf(ExpressionNodePtr const *first, std::size_t count) {
+            ExpressionHashPolicy::OperatorHasher hasher(count);
+            for(std::size_t i = 0; i < count; ++i) {
+                hasher.add(first[i]->hash());
+            }
+            return hasher.result();
+        }
 
         size_t getSize() const {
-            return this->operands.size();
+            return operandCount;
         }
 
         ExpressionNodePtr const &getOperator() const {
-            return this->operands.front();
+            return this->operandStorage()[0];
         }
 
-        OperandContainer const &getOperands() const {
-            return operands;
+        OperandRange getOperands() const {
+            return OperandRange(this->operandStorage(), operandCount);
         }
 
         IHT::hash_type hash() const {
             return hashCache;
         }
 
-        std::string toString() const {
-            std::string result = "(";
-            if(this->operands.size() > 0) {
-                auto iter = this->operands.cbegin();
-                result += (*iter)->toString();
-                while(++iter != this->operands.cend()) {
-                    result += std::string(" ") + (*iter)->toString();
-                }
-            }
-            result += ")";
-            return result;
+        std::uint32_t getDepth() const {
+            return depth;
         }
+        std::uint64_t getTreeSize() const {
+            return treeSize;
+        }
+        DagSizeSketch getDagSizeSketch() const {
+            return dagSizeSketch;
+        }
+        SymbolSignature getSymbolSignature() const {
+            return symbolSignature;
+        }
+
+        std::size_t memoryFootprint() const {
+            return this->allocationSize();
+        }
+
+        // Written by writeExpression, see expression_writer.hpp
+        std::string toString() const;
 
         bool equal_to(ExpressionNode const *other) const {
             if(Operator::classof(other)) {
                 Operator const *op = static_cast<Operator const *>(other);
-                if(this->operands.size() == op->operands.size()) {
-                    for(decltype(this->operands.size()) i = 0; i < this->operands.size(); ++i) {
-                        if(!this->operands.at(i)->equal_to(op->operands.at(i).get())) {
+                if(this->operandCount == op->operandCount) {
+                    auto const operands = this->operandStorage();
+                    auto const otherOperands = op->operandStorage();
+                    for(std::size_t i = 0; i < this->operandCount; ++i) {
+                        if(!operands[i]->equal_to(otherOperands[i].get())) {
                             return false;
                         }
                     }
@@ -110,28 +275,28 @@ namespace libexpressions {
         }
 
         Iterator begin() const {
-            return this->operands.begin();
+            return this->operandStorage();
         }
         Iterator end() const {
-            return this->operands.end();
+            return this->operandStorage() + operandCount;
         }
         Iterator cbegin() const {
-            return this->operands.cbegin();
+            return this->begin();
         }
         Iterator cend() const {
-            return this->operands.cend();
+            return this->end();
         }
 
     public:
         static ExpressionNodePtr followPath(ExpressionNodePtr const &ptr, Operator::Path const &path) {
             ExpressionNodePtr current = ptr;
             for(Operator::Path::const_iterator iter = path.begin(); iter != path.end(); ++iter) {
-                if(not dynamic_cast<Operator const*>(current.get())) {
+                if(not Operator::classof(current.get())) {
                     return nullptr;
                 } else {
-                    Operator const *op = dynamic_cast<Operator const *>(current.get());
-                    if(op->getOperands().size() > *iter) {
-                        current = op->getOperands().at((*iter));
+                    Operator const *op = static_cast<Operator const *>(current.get());
+                    if(op->getSize() > *iter) {
+                        current = op->getOperands()[*iter];
                     } else {
                         return nullptr;
                     }
@@ -141,6 +306,6 @@ namespace libexpressions {
         }
     };
 
-    typedef std::shared_ptr<Operator> OperatorPtr;
+    typedef IHT::IHTPtr<Operator> OperatorPtr;
 }
 
@@ -0,0 +1,233 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "libexpressions/expressions/expression_hash.hpp"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace libexpressions {
+    // Dense identifier of an interned symbol
+    typedef std::uint32_t SymbolId;
+
+    // Interns the symbols of atoms. Every distinct symbol is assigned a
+    // dense SymbolId and stored together with its hash. Two atoms have the
+    // same symbol if and only if they have the same SymbolId. Symbols are
+    // reference counted by the atoms and expression stores referring to
+    // them and released together with the last of these, after which their
+    // ids are handed out again. Symbols and hashes are looked up by id
+    // without locking; interning and releasing lock one of several shards.
+    class SymbolTable {
+    private:
+        struct Symbol {
+            std::string text;
+            IHT::hash_type hash;
+            // Protected by the mutex of the shard of the symbol
+            std::size_t references;
+        };
+        // Symbols are stored in chunks of doubling size which never move, so
+        // references to symbols stay valid while further symbols are added.
+        static constexpr std::size_t firstChunkSizeLog2 = 6;
+        static constexpr std::size_t chunkCount = 32u - firstChunkSizeLog2;
+        static constexpr std::size_t shardCount = 64;
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            std::unordered_map<std::string_view, SymbolId> ids;
+        };
+
+        std::array<std::atomic<Symbol*>, chunkCount> chunks{};
+        // Exceeds all ids handed out so far
+        std::atomic<std::uint64_t> idCount{0};
+        std::atomic<std::uint64_t> symbolCount{0};
+        // Ids of released symbols, which are handed out before new ones
+        std::mutex freeIdMutex;
+        std::vector<SymbolId> freeIds;
+        // Bytes of symbols too long for the buffer of their string
+        std::atomic<std::size_t> textBytes{0};
+        std::unique_ptr<Shard[]> const shards;
+
+        static std::size_t chunkSizeOf(std::size_t chunk) {
+            return std::size_t(1) << (chunk + firstChunkSizeLog2);
+        }
+        static std::size_t floorLog2(std::uint64_t value) {
+            std::size_t result = 0;
+            for(std::size_t shift = 32; shift > 0; shift >>= 1u) {
+                if((value >> shift) != 0) {
+                    value >>= shift;
+                    result += shift;
+                }
+            }
+            return result;
+        }
+        // The position of the symbol with the given id in its chunk
+        static std::pair<std::size_t, std::size_t> locate(SymbolId id) {
+            auto const position = std::uint64_t(id) + (std::uint64_t(1) << firstChunkSizeLog2);
+            auto const chunk = floorLog2(position) - firstChunkSizeLog2;
+            return {chunk, static_cast<std::size_t>(position - chunkSizeOf(chunk))};
+        }
+
+        Symbol *chunkOf(std::size_t chunk) {
+            auto current = chunks[chunk].load(std::memory_order_acquire);
+            if(current == nullptr) {
+                auto const allocated = static_cast<Symbol*>(::operator new(chunkSizeOf(chunk) * sizeof(Symbol)));
+                if(chunks[chunk].compare_exchange_strong(current, allocated, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    current = allocated;
+                } else {
+                    ::operator delete(allocated);
+                }
+            }
+            return current;
+        }
+
+        Symbol &symbolAt(SymbolId id) const {
+            auto const [chunk, index] = locate(id);
+            assert(id < idCount.load(std::memory_order_relaxed));
+            return chunks[chunk].load(std::memory_order_acquire)[index];
+        }
+        Shard &shardOf(IHT::hash_type hash) const {
+            return shards[(hash >> 8u) & (shardCount - 1u)];
+        }
+
+        // Requires the mutex of the shard of the new symbol to be held
+        SymbolId allocateId() {
+            {
+                std::lock_guard<std::mutex> lock(freeIdMutex);
+                if(not freeIds.empty()) {
+                    auto const id = freeIds.back();
+                    freeIds.pop_back();
+                    return id;
+                }
+            }
+            auto const count = idCount.fetch_add(1, std::memory_order_relaxed);
+            if(count > std::numeric_limits<SymbolId>::max() - chunkSizeOf(0)) {
+                idCount.fetch_sub(1, std::memory_order_relaxed);
+                throw std::length_error("Too many symbols");
+            }
+            return static_cast<SymbolId>(count);
+        }
+
+        SymbolTable() : shards(new Shard[shardCount]) {}
+    public:
+        SymbolTable(SymbolTable const &) = delete;
+        SymbolTable &operator=(SymbolTable const &) = delete;
+
+        // The table used by all atoms. It is never destroyed, as nodes might
+        // be destroyed during static destruction.
+        static SymbolTable &get() {
+            static SymbolTable *table = new SymbolTable();
+            return *table;
+        }
+
+        // Returns the id of `text`, holding a reference to it which has to
+        // be given up by `release`
+        SymbolId intern(std::string_view text) {
+            return this->intern(text, ExpressionHashPolicy::hashSymbol(text));
+        }
+        // `hash` has to be the hash of `text`
+        SymbolId intern(std::string_view text, IHT::hash_type hash) {
+            assert(hash == ExpressionHashPolicy::hashSymbol(text));
+            auto &shard = this->shardOf(hash);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if(auto found = shard.ids.find(text); found != shard.ids.end()) {
+                ++this->symbolAt(found->second).references;
+                return found->second;
+            }
+            auto const id = this->allocateId();
+            auto const [chunk, index] = locate(id);
+            auto const symbol = ::new(this->chunkOf(chunk) + index) Symbol{std::string(text), hash, 1};
+            if(symbol->text.capacity() > std::string().capacity()) {
+                textBytes.fetch_add(symbol->text.capacity() + 1u, std::memory_order_relaxed);
+            }
+            shard.ids.emplace(std::string_view(symbol->text), id);
+            symbolCount.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+        // Adds a reference to a symbol the caller already holds one to
+        void acquire(SymbolId id) {
+            auto &symbol = this->symbolAt(id);
+            std::lock_guard<std::mutex> lock(this->shardOf(symbol.hash).mutex);
+            ++symbol.references;
+        }
+        // Gives up a reference. The symbol is released with its last one.
+        void release(SymbolId id) {
+            auto &symbol = this->symbolAt(id);
+            auto &shard = this->shardOf(symbol.hash);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            assert(symbol.references > 0);
+            if(--symbol.references != 0) {
+                return;
+            }
+            shard.ids.erase(std::string_view(symbol.text));
+            if(symbol.text.capacity() > std::string().capacity()) {
+                textBytes.fetch_sub(symbol.text.capacity() + 1u, std::memory_order_relaxed);
+            }
+            symbol.~Symbol();
+            symbolCount.fetch_sub(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> freeIdLock(freeIdMutex);
+            freeIds.push_back(id);
+        }
+
+        // Only valid while a reference to the symbol is held
+        std::string const &symbolOf(SymbolId id) const {
+            return this->symbolAt(id).text;
+        }
+        IHT::hash_type hashOf(SymbolId id) const {
+            return this->symbolAt(id).hash;
+        }
+
+        // Number of symbols referred to
+        std::size_t size() const {
+            return static_cast<std::size_t>(symbolCount.load(std::memory_order_relaxed));
+        }
+
+        // Bytes of the chunks and of symbols stored outside of them. The
+        // size of the index is estimated from the number of symbols.
+        std::size_t memoryUsage() const {
+            std::size_t result = textBytes.load(std::memory_order_relaxed);
+            for(std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+                if(chunks[chunk].load(std::memory_order_relaxed) != nullptr) {
+                    result += chunkSizeOf(chunk) * sizeof(Symbol);
+                }
+            }
+            // A node holding the key, the id and the next pointer, and a
+            // bucket per symbol
+            auto const indexEntryBytes = sizeof(std::pair<std::string_view const, SymbolId>) + 2u * sizeof(void*);
+            return result + this->size() * indexEntryBytes + shardCount * sizeof(Shard);
+        }
+    };
+}
@@ -0,0 +1,206 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+namespace IHT {
+    // Epoch based reclamation for data structures which are read without
+    // locks. Readers pin the current epoch for the duration of their access.
+    // Objects which have been unlinked from such a data structure are retired
+    // and only destroyed once every thread which might still access them has
+    // left the epoch it was in when the object was retired.
+    class EpochManager {
+    public:
+        typedef std::uint64_t epoch_type;
+    private:
+        static constexpr epoch_type inactive = 0;
+
+        struct alignas(64) ThreadRecord {
+            std::atomic<epoch_type> epoch{inactive};
+            std::atomic<bool> inUse{true};
+            ThreadRecord *next = nullptr;
+            // Only accessed by the thread owning this record
+            std::size_t pinDepth = 0;
+        };
+
+        std::atomic<epoch_type> globalEpoch{inactive + 1};
+        // Records are never freed but reused by threads started after the
+        // previous owner has exited.
+        std::atomic<ThreadRecord*> records{nullptr};
+
+        EpochManager() = default;
+
+        ThreadRecord *acquireRecord() {
+            for(auto record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                bool expected = false;
+                if(record->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                    return record;
+                }
+            }
+            auto record = new ThreadRecord;
+            record->next = records.load(std::memory_order_relaxed);
+            while(not records.compare_exchange_weak(record->next, record, std::memory_order_acq_rel)) { }
+            return record;
+        }
+
+        ThreadRecord &localRecord() {
+            thread_local struct RecordHolder {
+                ThreadRecord *record = nullptr;
+                ~RecordHolder() {
+                    if(record != nullptr) {
+                        record->inUse.store(false, std::memory_order_release);
+                    }
+                }
+            } holder;
+            if(holder.record == nullptr) {
+                holder.record = this->acquireRecord();
+            }
+            return *holder.record;
+        }
+    public:
+        EpochManager(EpochManager const &) = delete;
+        EpochManager &operator=(EpochManager const &) = delete;
+
+        static EpochManager &get() {
+            static EpochManager instance;
+            return instance;
+        }
+
+        // Keeps the calling thread pinned to an epoch while it exists. Guards
+        // may be nested.
+        class Guard {
+        private:
+            ThreadRecord &record;
+        public:
+            explicit Guard(ThreadRecord &paramRecord) : record(paramRecord) {
+                if(record.pinDepth++ == 0) {
+                    record.epoch.store(EpochManager::get().globalEpoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+            }
+            ~Guard() {
+                if(--record.pinDepth == 0) {
+                    record.epoch.store(inactive, std::memory_order_release);
+                }
+            }
+            Guard(Guard const &) = delete;
+            Guard &operator=(Guard const &) = delete;
+        };
+
+        Guard pin() {
+            return Guard(this->localRecord());
+        }
+
+        epoch_type currentEpoch() const {
+            return globalEpoch.load(std::memory_order_seq_cst);
+        }
+
+        // Advances the global epoch if all pinned threads have observed the
+        // current one and returns the (possibly advanced) global epoch.
+        epoch_type tryAdvance() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto current = globalEpoch.load(std::memory_order_seq_cst);
+            for(auto record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                auto const epoch = record->epoch.load(std::memory_order_seq_cst);
+                if(epoch != inactive and epoch != current) {
+                    return current;
+                }
+            }
+            globalEpoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+            return globalEpoch.load(std::memory_order_seq_cst);
+        }
+
+        // An object retired in epoch `retiredIn` cannot be accessed by any
+        // thread anymore once the global epoch is two epochs ahead of it.
+        static constexpr bool isReclaimable(epoch_type retiredIn, epoch_type global) {
+            return retiredIn + 2 <= global;
+        }
+    };
+
+    // A list of retired objects awaiting their destruction. The list itself
+    // is not synchronised and has to be protected by its owner.
+    class RetireList {
+    public:
+        // Called with the retired object and the context given when retiring it
+        typedef void (*Reclaimer)(void *object, void *context);
+        typedef std::tuple<EpochManager::epoch_type, void*, void*, Reclaimer> RetiredObject;
+    private:
+        std::vector<RetiredObject> retired;
+    public:
+        RetireList() = default;
+        RetireList(RetireList const &) = delete;
+        RetireList &operator=(RetireList const &) = delete;
+        ~RetireList() {
+            RetireList::destroy(std::move(retired));
+        }
+
+        // Must be called after `object` has been unlinked.
+        template<typename T>
+        void retire(T *object) {
+            this->retire(object, nullptr, [](void *ptr, void*) {
+                delete static_cast<T*>(ptr);
+            });
+        }
+        void retire(void *object, void *context, Reclaimer reclaim) {
+            retired.emplace_back(EpochManager::get().currentEpoch(), object, context, reclaim);
+        }
+
+        std::size_t size() const {
+            return retired.size();
+        }
+
+        // Removes all objects which can safely be destroyed from the list and
+        // returns them. They should be destroyed using `destroy` without
+        // holding the lock protecting this list, as destructors might need to
+        // acquire it.
+        std::vector<RetiredObject> takeReclaimable() {
+            auto const global = EpochManager::get().tryAdvance();
+            auto firstReclaimable = std::partition(retired.begin(), retired.end(), [global](auto const &object) {
+                return not EpochManager::isReclaimable(std::get<0>(object), global);
+            });
+            std::vector<RetiredObject> result(std::make_move_iterator(firstReclaimable), std::make_move_iterator(retired.end()));
+            retired.erase(firstReclaimable, retired.end());
+            return result;
+        }
+
+        // Removes all objects from the list regardless of whether they might
+        // still be accessed.
+        std::vector<RetiredObject> takeAll() {
+            std::vector<RetiredObject> result;
+            result.swap(retired);
+            return result;
+        }
+
+        static void destroy(std::vector<RetiredObject> &&objects) {
+            for(auto const &[_, object, context, reclaim] : objects) {
+                reclaim(object, context);
+            }
+        }
+    };
+}
@@ -0,0 +1,92 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace IHT {
+    // Executors run a number of independent tasks. Calling an executor with
+    // `taskCount` and `task` calls `task(idx)` for every `idx` below
+    // `taskCount`, in any order and possibly concurrently, and returns once
+    // all tasks have finished. An exception thrown by a task is rethrown
+    // after all tasks have finished. Any callable meeting these
+    // requirements, e.g. an adapter for an existing thread pool, may be used
+    // where an executor is expected.
+    struct SequentialExecutor {
+        template<typename Task>
+        void operator()(std::size_t taskCount, Task const &task) const {
+            for(std::size_t idx = 0; idx < taskCount; ++idx) {
+                task(idx);
+            }
+        }
+    };
+
+    // Runs tasks on up to `threadCount` threads including the calling
+    // thread. Threads are started for every call, so it only pays off for
+    // tasks which take considerably longer than starting a thread.
+    class ThreadExecutor {
+    private:
+        std::size_t const threadCount;
+    public:
+        explicit ThreadExecutor(std::size_t paramThreadCount = std::max(1u, std::thread::hardware_concurrency()))
+            : threadCount(std::max<std::size_t>(1u, paramThreadCount)) {}
+
+        template<typename Task>
+        void operator()(std::size_t taskCount, Task const &task) const {
+            std::atomic<std::size_t> nextTask{0};
+            std::mutex errorMutex;
+            std::exception_ptr error;
+            auto const work = [&]() {
+                for(auto idx = nextTask.fetch_add(1, std::memory_order_relaxed); idx < taskCount; idx = nextTask.fetch_add(1, std::memory_order_relaxed)) {
+                    try {
+                        task(idx);
+                    } catch(...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if(error == nullptr) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+            };
+            std::vector<std::thread> threads;
+            auto const helpers = std::min(threadCount, taskCount);
+            threads.reserve(helpers);
+            for(std::size_t idx = 1; idx < helpers; ++idx) {
+                threads.emplace_back(work);
+            }
+            work();
+            for(auto &thread : threads) {
+                thread.join();
+            }
+            if(error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}
@@ -23,133 +23,884 @@
 #pragma once
 
 #include "libexpressions/iht/iht_node.hpp"
-#include <unordered_map>
+#include "libexpressions/iht/iht_epoch.hpp"
+#include "libexpressions/iht/iht_executor.hpp"
+#include "libexpressions/iht/iht_slab_arena.hpp"
+#include "libexpressions/iht/iht_statistics.hpp"
+#include <array>
+#include <atomic>
 #include <memory>
 #include <type_traits>
 #include <vector>
 #include <algorithm>
 #include <mutex>
-#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 #include <optional>
+#include <utility>
 #include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <tuple>
 #include <iostream>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
 
 namespace IHT {
+    // Determines when nodes which are not referenced anymore are removed
+    // from the factory and destroyed
+    enum class UnregistrationMode {
+        // By the thread releasing the last reference
+        IMMEDIATE,
+        // In batches by calls to `IHTFactory::collect`
+        DEFERRED,
+        // In batches by a background thread owned by the factory
+        BACKGROUND
+    };
+
+    // Node types may classify their nodes for memory reports by providing
+    // `static constexpr std::size_t memoryClassCount`, `std::size_t
+    // memoryClass() const`, returning a class below that count, and
+    // `std::size_t memoryFootprint() const`, the number of bytes occupied by
+    // the node including data stored behind it or out of line. The
+    // footprint of a node must not change.
+    template<typename NodeType, typename = void>
+    struct IHTNodeMemoryClasses {
+        static constexpr std::size_t count = 1;
+        static std::size_t classOf(NodeType const *) {
+            return 0;
+        }
+        static std::size_t footprintOf(NodeType const *) {
+            return sizeof(NodeType);
+        }
+    };
+    template<typename NodeType>
+    struct IHTNodeMemoryClasses<NodeType, std::void_t<decltype(NodeType::memoryClassCount)>> {
+        static constexpr std::size_t count = NodeType::memoryClassCount;
+        static std::size_t classOf(NodeType const *node) {
+            return node->memoryClass();
+        }
+        static std::size_t footprintOf(NodeType const *node) {
+            return node->memoryFootprint();
+        }
+    };
+
     template<typename NodeType>
     class IHTFactory {
     private: //private typedefs
-        typedef typename IHT::IHTNodePtr<NodeType>::weak_type IHTWeakNodePtr;
         typedef typename IHT::IHTNode<NodeType> const * IHTNodePtr;
-        typedef std::vector<std::tuple<IHTNodePtr, typename IHT::IHTFactory<NodeType>::IHTWeakNodePtr>> IHTWeakNodePtrContainer;
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        // Entries are immutable once they have been published in a table.
+        // Nodes whose reference count dropped to zero are about to be
+        // unregistered and are skipped by lookups.
+        struct Entry {
+            IHT::hash_type const hash;
+            IHTNodePtr const node;
+        };
+#else
+        typedef typename IHT::IHTNodePtr<NodeType>::weak_type IHTWeakNodePtr;
+        // Entries are immutable once they have been published in a table.
+        struct Entry {
+            IHT::hash_type const hash;
+            IHTNodePtr const node;
+            IHTWeakNodePtr const weakNode;
+        };
+#endif
+        // A node which is not referenced anymore. It is disposed of by
+        // unregistering it, retiring `object` with `reclaim` if set and
+        // finally calling `destroy` on `object` if set.
+        struct Disposal {
+            IHTNodePtr node;
+            IHT::hash_type hash;
+            void *object;
+            void *context;
+            IHT::RetireList::Reclaimer reclaim;
+            IHT::RetireList::Reclaimer destroy;
+        };
+        // An open addressing hash table with linear probing. Slots are
+        // written only while holding the mutex of the owning shard but may
+        // be read at any time by threads which pinned the current epoch.
+        // Removed entries are replaced by a tombstone to keep probe
+        // sequences intact. Tables are never resized in place; a larger or
+        // smaller copy is published instead and the old one is retired.
+        struct Table {
+            std::size_t const capacity;
+            std::unique_ptr<std::atomic<Entry*>[]> const slots;
+
+            explicit Table(std::size_t paramCapacity)
+                : capacity(paramCapacity),
+                  slots(new std::atomic<Entry*>[paramCapacity]) {
+                for(std::size_t idx = 0; idx < capacity; ++idx) {
+                    slots[idx].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+        };
+        // The node table is split into shards which are selected by the hash
+        // of a node. Every shard is guarded by its own mutex, so threads
+        // inserting or deleting nodes of different shards do not contend.
+        // Lookups do not take the mutex at all. Shards are aligned to cache
+        // lines to avoid false sharing between neighbouring shards.
+        struct alignas(64) Shard {
+            std::atomic<Table*> table;
+            // Incremented before entries are removed
+            std::atomic<std::uint64_t> generation{0};
+            std::mutex mutex;
+            // The following members are protected by `mutex`
+            std::size_t liveEntries = 0;
+            std::size_t usedSlots = 0;
+            std::array<IHT::IHTFactoryMemoryReport::NodeClassUsage, IHTNodeMemoryClasses<NodeType>::count> nodeClasses{};
+            IHT::RetireList retired;
+            // Nodes awaiting their unregistration if it is deferred
+            std::mutex disposalMutex;
+            std::vector<Disposal> pendingDisposals;
+
+            Shard() : table(new Table(minimumTableCapacity)) { }
+            ~Shard() {
+                auto currentTable = table.load(std::memory_order_relaxed);
+                for(std::size_t idx = 0; idx < currentTable->capacity; ++idx) {
+                    if(auto entry = currentTable->slots[idx].load(std::memory_order_relaxed);
+                        entry != nullptr and entry != tombstone()) {
+                        delete entry;
+                    }
+                }
+                delete currentTable;
+            }
+        };
+        // Entry of the direct mapped per thread cache of recently used
+        // entries. It saves probing the node table for nodes which are
+        // created over and over again.
+        struct CachedEntry {
+            std::uint64_t factoryId;
+            std::uint64_t generation;
+            IHT::hash_type hash;
+            Entry const *entry;
+        };
+        // Destroys nodes allocated in the arena which have never been owned
+        // by a shared pointer.
+        template<typename SpecialisedType>
+        struct ArenaNodeDeleter {
+            IHT::SlabArena *arena;
+            void operator()(SpecialisedType *node) const {
+                auto const slotSize = arenaSlotSizeOf(node);
+                node->~SpecialisedType();
+                arena->deallocate(node, slotSize);
+            }
+        };
+        // Context of nodes with a custom deleter
+        template<typename SpecialisedType, typename Deleter>
+        struct CustomDeletion {
+            IHTFactory<NodeType> *factory;
+            SpecialisedType *node;
+            Deleter deleter;
+        };
+#ifndef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        // Deleter of shared pointers owning nodes allocated in the arena.
+        // The memory of the node is released together with the control block
+        // of the shared pointer by `ControlBlockAllocator`.
+        template<typename SpecialisedType>
+        struct ArenaNodeDisposer {
+            IHTFactory<NodeType> *factory;
+            void operator()(SpecialisedType *node) const {
+                factory->disposeNode(Disposal{node, node->hash(), node, nullptr, nullptr, &destroyNode<SpecialisedType>});
+            }
+        };
+        // Deleter of shared pointers owning nodes with a custom deleter
+        template<typename SpecialisedType, typename Deleter>
+        struct CustomDeletionDisposer {
+            CustomDeletion<SpecialisedType, Deleter> *deletion;
+            void operator()(SpecialisedType *node) const {
+                deletion->factory->disposeNode(Disposal{node, node->hash(), deletion, nullptr, nullptr, &runCustomDeletion<SpecialisedType, Deleter>});
+            }
+        };
+        // Allocates the control block of a shared pointer owning a node
+        // allocated in the arena. Arena slots of nodes reserve space for the
+        // control block behind the node, so both share a single allocation.
+        // If the control block happens not to fit, it is allocated
+        // separately. The slot of the node is released when the control
+        // block is deallocated, i.e. once the node has been destroyed and
+        // there are no weak pointers to it anymore.
+        template<typename T>
+        struct ControlBlockAllocator {
+            typedef T value_type;
+
+            IHT::SlabArena *arena;
+            void *slot;
+            std::uint32_t nodeSize;
+            std::uint32_t slotSize;
+
+            ControlBlockAllocator(IHT::SlabArena *paramArena, void *paramSlot, std::uint32_t paramNodeSize, std::uint32_t paramSlotSize)
+                : arena(paramArena), slot(paramSlot), nodeSize(paramNodeSize), slotSize(paramSlotSize) { }
+            template<typename U>
+            ControlBlockAllocator(ControlBlockAllocator<U> const &other)
+                : arena(other.arena), slot(other.slot), nodeSize(other.nodeSize), slotSize(other.slotSize) { }
+
+            T *allocate(std::size_t n) {
+                if(alignof(T) <= IHT::SlabArena::granularity and n * sizeof(T) <= slotSize - nodeSize) {
+                    return reinterpret_cast<T*>(this->reservedSpace());
+                }
+                return static_cast<T*>(arena->allocate(n * sizeof(T)));
+            }
+            void deallocate(T *ptr, std::size_t n) {
+                if(reinterpret_cast<char*>(ptr) != this->reservedSpace()) {
+                    arena->deallocate(ptr, n * sizeof(T));
+                }
+                arena->deallocate(slot, slotSize);
+            }
+            char *reservedSpace() const {
+                return static_cast<char*>(slot) + nodeSize;
+            }
+
+            template<typename U>
+            bool operator==(ControlBlockAllocator<U> const &other) const {
+                return arena == other.arena and slot == other.slot;
+            }
+            template<typename U>
+            bool operator!=(ControlBlockAllocator<U> const &other) const {
+                return not (*this == other);
+            }
+        };
+#endif
+    public: //public constants
+        static constexpr std::size_t defaultShardCount = 64;
+    private: //private constants
+        static constexpr std::size_t minimumTableCapacity = 16;
+        // Retired entries and tables are only reclaimed in batches
+        static constexpr std::size_t reclamationThreshold = 64;
+        // Number of entries of the cache of every thread, a power of two
+        static constexpr std::size_t threadCacheSize = 256;
+        // Number of nodes looked up by every task of a bulk insertion
+        static constexpr std::size_t bulkLookupTaskSize = 1024;
+        // Pause of the background thread between collections
+        static constexpr std::chrono::milliseconds collectionInterval{10};
+        // Events counted in `statistics`
+        enum Statistic : std::size_t {
+            LOOKUP_HITS,
+            LOOKUP_MISSES,
+            THREAD_CACHE_HITS,
+            INSERTIONS,
+            INSERTION_RACES_LOST,
+            UNREGISTRATIONS,
+            CONTENDED_LOCKS,
+            LOCK_WAIT_NANOSECONDS,
+            STATISTIC_COUNT
+        };
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        // The reference count is part of the node
+        static constexpr std::size_t controlBlockReserve = 0;
+#else
+        // Estimate of the size of a shared pointer control block using
+        // `ArenaNodeDisposer` and `ControlBlockAllocator`: a vtable pointer,
+        // the reference counts, the owned pointer, the deleter and the
+        // allocator.
+        static constexpr std::size_t controlBlockReserve = IHT::SlabArena::slotSizeOf(
+            4u * sizeof(void*) + sizeof(ArenaNodeDisposer<NodeType>) + sizeof(ControlBlockAllocator<char>));
+#endif
     private: //private member functions
-        //Not thread safe
+        template<typename SpecialisedType, typename Deleter, typename Adopter>
+        IHT::IHTNodePtr<NodeType> findOrInsertNode(std::unique_ptr<SpecialisedType, Deleter> &&node, Adopter &&adopt);
+        template<typename SpecialisedType, typename Deleter, typename Adopter>
+        IHT::IHTNodePtr<NodeType> insertNode(std::unique_ptr<SpecialisedType, Deleter> &&node, Adopter &&adopt);
+
+        // Node types may store data of variable size directly behind the
+        // object, such as the operands of an operator. They provide
+        // `std::size_t allocationSize() const`, the number of bytes occupied
+        // by the node including that data, and `static std::size_t
+        // allocationSizeFor(Args const &...)`, the number of bytes occupied by
+        // a node constructed from `args`. Such nodes can only be allocated in
+        // the arena.
+        template<typename SpecialisedType, typename = void>
+        struct HasTrailingStorage : std::false_type {};
+        template<typename SpecialisedType>
+        struct HasTrailingStorage<SpecialisedType, std::void_t<decltype(std::declval<SpecialisedType const&>().allocationSize())>> : std::true_type {};
+
+        template<typename SpecialisedType, class ... Args>
+        static std::size_t nodeSizeFor(Args const &...args) {
+            if constexpr(HasTrailingStorage<SpecialisedType>::value) {
+                return SpecialisedType::allocationSizeFor(args...);
+            } else {
+                return sizeof(SpecialisedType);
+            }
+        }
+        template<typename SpecialisedType>
+        static std::size_t nodeSizeOf(SpecialisedType const *node) {
+            if constexpr(HasTrailingStorage<SpecialisedType>::value) {
+                return node->allocationSize();
+            } else {
+                return sizeof(SpecialisedType);
+            }
+        }
+
+        static constexpr std::size_t arenaSlotSizeFor(std::size_t nodeSize) {
+            return IHT::SlabArena::slotSizeOf(nodeSize) + controlBlockReserve;
+        }
+        template<typename SpecialisedType>
+        static std::size_t arenaSlotSizeOf(SpecialisedType const *node) {
+            return arenaSlotSizeFor(nodeSizeOf(node));
+        }
+
+        template<typename SpecialisedType, class ... Args>
+        std::unique_ptr<SpecialisedType, ArenaNodeDeleter<SpecialisedType>> constructInArena(Args&& ...args) {
+            static_assert(alignof(SpecialisedType) <= IHT::SlabArena::granularity, "IHTFactory cannot create over-aligned objects.");
+            auto const slotSize = arenaSlotSizeFor(nodeSizeFor<SpecialisedType>(args...));
+            auto const slot = arena.allocate(slotSize);
+            SpecialisedType *node = nullptr;
+            try {
+                node = ::new(slot) SpecialisedType(std::forward<Args>(args)...);
+            } catch(...) {
+                arena.deallocate(slot, slotSize);
+                throw;
+            }
+            return std::unique_ptr<SpecialisedType, ArenaNodeDeleter<SpecialisedType>>(node, ArenaNodeDeleter<SpecialisedType>{&arena});
+        }
+
+        template<typename SpecialisedType>
+        static void destroyNode(void *object, void*) {
+            static_cast<SpecialisedType*>(object)->~SpecialisedType();
+        }
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        // The memory of a node is reclaimed after the node has been
+        // destroyed, so the size of its slot is encoded in the reclaimer.
+        template<std::size_t SlotSize>
+        static void deallocateSlot(void *object, void *factory) {
+            static_cast<IHTFactory<NodeType>*>(factory)->arena.deallocate(object, SlotSize);
+        }
+        template<std::size_t ...SizeClasses>
+        static IHT::RetireList::Reclaimer slotDeallocatorFor(std::size_t slotSize, std::index_sequence<SizeClasses...>) {
+            static constexpr IHT::RetireList::Reclaimer deallocators[] = {
+                &deallocateSlot<(SizeClasses + 1u) * IHT::SlabArena::granularity>...
+            };
+            return deallocators[slotSize / IHT::SlabArena::granularity - 1u];
+        }
+        // Only for slots within the size classes of the arena
+        static IHT::RetireList::Reclaimer slotDeallocatorFor(std::size_t slotSize) {
+            assert(slotSize <= IHT::SlabArena::maximumSlabSize);
+            return slotDeallocatorFor(slotSize, std::make_index_sequence<IHT::SlabArena::maximumSlabSize / IHT::SlabArena::granularity>());
+        }
+        // Slots exceeding the size classes have arbitrary sizes, which are
+        // passed to the reclaimer as its context instead
+        struct OversizedSlot {
+            IHTFactory<NodeType> *factory;
+            std::size_t size;
+        };
+        static void deallocateOversizedSlot(void *object, void *context) {
+            auto const slot = static_cast<OversizedSlot*>(context);
+            slot->factory->arena.deallocate(object, slot->size);
+            delete slot;
+        }
+#endif
         template<typename SpecialisedType, typename Deleter>
-        IHT::IHTNodePtr<NodeType> findOrInsertNode(std::unique_ptr<SpecialisedType, Deleter> &&node);
+        static void runCustomDeletion(void *object, void*) {
+            auto const deletion = static_cast<CustomDeletion<SpecialisedType, Deleter>*>(object);
+            deletion->deleter(static_cast<NodeType*>(deletion->node));
+            delete deletion;
+        }
+
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        template<typename SpecialisedType>
+        IHT::IHTNodePtr<NodeType> adoptArenaNode(std::unique_ptr<SpecialisedType, ArenaNodeDeleter<SpecialisedType>> &&node) {
+            node->disposer = IHT::IHTNodeDisposers<NodeType>::template indexOf<&IHTFactory::disposeArenaNode<SpecialisedType>>();
+            node->disposalContext = this;
+            return IHT::IHTNodePtr<NodeType>(node.release());
+        }
 
         template<typename Deleter>
-        decltype(auto) getNodeDeleter(Deleter &&deleter) {
-            return [deleter,this](IHT::IHTNode<NodeType> *node) {
-                       if(node != nullptr) {
-                           this->unregisterNode(node);
-                           deleter(static_cast<NodeType*>(node));
-                       }
-                   };
+        decltype(auto) adoptWithDeleter(Deleter &&deleter) {
+            return [this,&deleter](auto &&node) {
+                typedef typename std::decay_t<decltype(node)>::element_type SpecialisedType;
+                typedef CustomDeletion<SpecialisedType, std::decay_t<Deleter>> Deletion;
+                auto const index = IHT::IHTNodeDisposers<NodeType>::template indexOf<&IHTFactory::disposeNodeWithDeleter<SpecialisedType, std::decay_t<Deleter>>>();
+                node->disposalContext = new Deletion{this, node.get(), std::forward<Deleter>(deleter)};
+                node->disposer = index;
+                return IHT::IHTNodePtr<NodeType>(node.release());
+            };
+        }
+
+        // Disposers of nodes whose reference count dropped to zero. As
+        // lock-free lookups might still inspect the reference count, the
+        // memory of a node is only reclaimed once they cannot anymore.
+        template<typename SpecialisedType>
+        static void disposeArenaNode(IHT::IHTNode<NodeType> const *node, void *context) {
+            auto const factory = static_cast<IHTFactory<NodeType>*>(context);
+            auto const specialised = const_cast<SpecialisedType*>(static_cast<SpecialisedType const*>(node));
+            auto const slotSize = arenaSlotSizeOf(specialised);
+            if(slotSize > IHT::SlabArena::maximumSlabSize) {
+                factory->disposeNode(Disposal{node, node->hash(), specialised, new OversizedSlot{factory, slotSize}, &deallocateOversizedSlot, &destroyNode<SpecialisedType>});
+                return;
+            }
+            factory->disposeNode(Disposal{node, node->hash(), specialised, factory, slotDeallocatorFor(slotSize), &destroyNode<SpecialisedType>});
+        }
+        template<typename SpecialisedType, typename Deleter>
+        static void disposeNodeWithDeleter(IHT::IHTNode<NodeType> const *node, void *context) {
+            auto const deletion = static_cast<CustomDeletion<SpecialisedType, Deleter>*>(context);
+            deletion->factory->disposeNode(Disposal{node, node->hash(), deletion, nullptr, &runCustomDeletion<SpecialisedType, Deleter>, nullptr});
+        }
+#else
+        template<typename SpecialisedType>
+        IHT::IHTNodePtr<NodeType> adoptArenaNode(std::unique_ptr<SpecialisedType, ArenaNodeDeleter<SpecialisedType>> &&node) {
+            auto const nodeSize = static_cast<std::uint32_t>(IHT::SlabArena::slotSizeOf(nodeSizeOf(node.get())));
+            auto const slotSize = static_cast<std::uint32_t>(arenaSlotSizeOf(node.get()));
+            auto const raw = node.release();
+            disposeNextImmediately() = true;
+            try {
+                IHT::IHTNodePtr<NodeType> adopted(raw, ArenaNodeDisposer<SpecialisedType>{this}, ControlBlockAllocator<char>(&arena, raw, nodeSize, slotSize));
+                disposeNextImmediately() = false;
+                return adopted;
+            } catch(...) {
+                // The shared pointer has already invoked the disposer
+                arena.deallocate(raw, slotSize);
+                throw;
+            }
         }
 
         template<typename Deleter>
-        using deleter_type = typename std::invoke_result<decltype(&IHT::IHTFactory<NodeType>::getNodeDeleter<Deleter>), IHT::IHTFactory<NodeType>*, Deleter>::type;
-
-        void unregisterNode(IHT::IHTNode<NodeType> *node) {
-            auto const hash = node->hash();
-            std::shared_lock<std::shared_mutex> nodesLock(this->nodesMutex);
-            auto &[ptrs, hashMutex] = nodes[hash];
-            std::unique_lock<std::shared_mutex> hashLock(hashMutex);
-            for(typename IHT::IHTFactory<NodeType>::IHTWeakNodePtrContainer::iterator iter = ptrs.begin();
-                iter != ptrs.end(); ++iter) {
-                auto &[ptr, weakPtr] = *iter;
-                //If the node is in here or if there is a nullptr
-                //  Note: The order for weak_ptr expiration and deleter call is undefined by the current standards. (https://cplusplus.github.io/LWG/issue2751)
-                //        Therefore, the weak_ptr we are looking for can either still be locked and return the pointer to the node or will be expired.
-                //        Thus, we erase the correct weak_ptr if we find it or any nullptr's we find on the way.
-                if(ptr == node or weakPtr.expired()) {
-                    ptrs.erase(iter);
-                    break;
-                }
-            }
-            hashLock.unlock();
-            if(ptrs.empty()) {
-                nodesLock.unlock(); //Unlocking to lock unique to modify node hash map
-                // Here, we assume anything can happen and someone else might
-                // insert another node with this hash or delete this element of
-                // the node hash map.
-                std::unique_lock<std::shared_mutex> exclusiveNodesLock(this->nodesMutex);
-                // We need to check everything again and assume, the node hash
-                // map has been modified.
-                if(nodes.count(hash) > 0) {
-                    auto &[ptrsExcl, hashExcl] = nodes.at(hash);
-                    std::unique_lock<std::shared_mutex> exclusiveHashLock(hashExcl);
-                    if(ptrsExcl.empty()) {
-                        nodes.erase(hash);
-                        // Hash mutex has been erased, just release it
-                        exclusiveHashLock.release();
+        decltype(auto) adoptWithDeleter(Deleter &&deleter) {
+            return [this,&deleter](auto &&node) {
+                typedef typename std::decay_t<decltype(node)>::element_type SpecialisedType;
+                typedef CustomDeletion<SpecialisedType, std::decay_t<Deleter>> Deletion;
+                auto const deletion = new Deletion{this, node.get(), std::forward<Deleter>(deleter)};
+                return IHT::IHTNodePtr<NodeType>(node.release(), CustomDeletionDisposer<SpecialisedType, std::decay_t<Deleter>>{deletion});
+            };
+        }
+#endif
+
+        static Entry *tombstone() {
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+            static Entry tombstoneEntry{0, nullptr};
+#else
+            static Entry tombstoneEntry{0, nullptr, {}};
+#endif
+            return &tombstoneEntry;
+        }
+
+        static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+            std::size_t result = 1;
+            while(result < value) {
+                result <<= 1u;
+            }
+            return result;
+        }
+
+        std::size_t shardIndexOf(IHT::hash_type hash) const {
+            // Hashes are not necessarily well mixed; the lowest byte of
+            // operator hashes under the XOR hash policy carries structural
+            // information rather than entropy. Fold the upper half of the
+            // hash into the lower half and skip that byte.
+            hash ^= hash >> (sizeof(IHT::hash_type) * 4u);
+            return (hash >> 8u) & (shardCount - 1u);
+        }
+        Shard &shardOf(IHT::hash_type hash) const {
+            return shards[this->shardIndexOf(hash)];
+        }
+
+        // First slot of the probe sequence for `hash`. Uses different bits
+        // than the shard selection.
+        static std::size_t firstSlotOf(IHT::hash_type hash, Table const *table) {
+            hash *= static_cast<IHT::hash_type>(0x9E3779B97F4A7C15ull);
+            hash ^= hash >> (sizeof(IHT::hash_type) * 4u);
+            return hash & (table->capacity - 1u);
+        }
+
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+        static Entry *makeEntry(IHT::IHTNodePtr<NodeType> const &node) {
+            return new Entry{node->hash(), node.get()};
+        }
+        static bool isAlive(Entry const *entry) {
+            return entry->node->referenceCount.load(std::memory_order_acquire) != 0;
+        }
+        static IHT::IHTNodePtr<NodeType> tryAcquire(Entry const *entry) {
+            return IHT::IHTNodePtr<NodeType>::tryAcquire(entry->node);
+        }
+#else
+        static Entry *makeEntry(IHT::IHTNodePtr<NodeType> const &node) {
+            return new Entry{node->hash(), node.get(), node};
+        }
+        static bool isAlive(Entry const *entry) {
+            return not entry->weakNode.expired();
+        }
+        static IHT::IHTNodePtr<NodeType> tryAcquire(Entry const *entry) {
+            return entry->weakNode.lock();
+        }
+#endif
+
+        // Requires the caller to either hold the mutex of the shard owning
+        // `table` or to have pinned the current epoch. `matches` is called
+        // with the nodes in the table having the given hash. The entry of
+        // the node found is stored in `foundEntry` if given.
+        template<bool shardLocked, typename Predicate>
+        static std::optional<IHT::IHTNodePtr<NodeType>> findMatchingNodeInTable(Table const *table, IHT::hash_type hash, Predicate const &matches,
+                                                                                 Entry const **foundEntry = nullptr) {
+            auto const mask = table->capacity - 1u;
+            for(auto idx = firstSlotOf(hash, table); ; idx = (idx + 1u) & mask) {
+                Entry const *entry = table->slots[idx].load(std::memory_order_acquire);
+                if(entry == nullptr) {
+                    return std::nullopt;
+                }
+                if(entry == tombstone() or entry->hash != hash) {
+                    continue;
+                }
+                if constexpr(shardLocked) {
+                    // Nodes are unregistered before they are destroyed, which
+                    // cannot happen while the mutex is held. A reference is
+                    // only acquired for the matching node, as releasing one
+                    // might require the mutex.
+                    if(isAlive(entry) and matches(static_cast<NodeType const*>(entry->node))) {
+                        if(auto acquired = tryAcquire(entry); acquired != nullptr) {
+                            if(foundEntry != nullptr) {
+                                *foundEntry = entry;
+                            }
+                            return acquired;
+                        }
+                    }
+                } else {
+                    // Acquiring a reference before comparing keeps the node
+                    // alive during the comparison and guarantees not to
+                    // return a node that expired after having been compared.
+                    if(auto acquired = tryAcquire(entry); acquired != nullptr and matches(static_cast<NodeType const*>(entry->node))) {
+                        if(foundEntry != nullptr) {
+                            *foundEntry = entry;
+                        }
+                        return acquired;
                     }
                 }
             }
         }
 
-        std::optional<IHT::IHTNodePtr<NodeType>> findEquivalentNodeAssumeLocked(IHT::IHTNode<NodeType> const *node) const {
-            if(node == nullptr) {
-                return std::nullopt;
+        template<bool shardLocked>
+        static std::optional<IHT::IHTNodePtr<NodeType>> findEquivalentNodeInTable(Table const *table, IHT::hash_type hash, IHT::IHTNode<NodeType> const *node) {
+            return findMatchingNodeInTable<shardLocked>(table, hash, [node](NodeType const *candidate) {
+                return node->equal_to(candidate);
+            });
+        }
+
+        // Requires the mutex of the shard owning `table` to be held.
+        // Returns whether an empty slot (rather than a tombstone) was used.
+        static bool placeEntry(Table *table, Entry *entry) {
+            auto const mask = table->capacity - 1u;
+            for(auto idx = firstSlotOf(entry->hash, table); ; idx = (idx + 1u) & mask) {
+                auto const current = table->slots[idx].load(std::memory_order_relaxed);
+                if(current == nullptr or current == tombstone()) {
+                    table->slots[idx].store(entry, std::memory_order_release);
+                    return current == nullptr;
+                }
+            }
+        }
+
+        // Requires the mutex of `shard` to be held. Publishes a copy of the
+        // shard's table without tombstones with a capacity suitable for
+        // `expectedEntries` entries and retires the current table.
+        void rebuildTable(Shard &shard, std::size_t expectedEntries) {
+            auto const oldTable = shard.table.load(std::memory_order_relaxed);
+            auto const newTable = new Table(std::max(minimumTableCapacity, roundUpToPowerOfTwo(expectedEntries * 4u)));
+            for(std::size_t idx = 0; idx < oldTable->capacity; ++idx) {
+                if(auto entry = oldTable->slots[idx].load(std::memory_order_relaxed);
+                    entry != nullptr and entry != tombstone()) {
+                    placeEntry(newTable, entry);
+                }
+            }
+            shard.usedSlots = shard.liveEntries;
+            shard.table.store(newTable, std::memory_order_release);
+            shard.retired.retire(oldTable);
+        }
+
+        // Requires the mutex of `shard` to be held.
+        void insertEntry(Shard &shard, Entry *entry) {
+            auto table = shard.table.load(std::memory_order_relaxed);
+            // Keep the load factor including tombstones at or below one half
+            if((shard.usedSlots + 1u) * 2u > table->capacity) {
+                this->rebuildTable(shard, shard.liveEntries + 1u);
+                table = shard.table.load(std::memory_order_relaxed);
+            }
+            if(placeEntry(table, entry)) {
+                ++shard.usedSlots;
+            }
+            ++shard.liveEntries;
+            auto const node = static_cast<NodeType const*>(entry->node);
+            auto &usage = shard.nodeClasses[IHTNodeMemoryClasses<NodeType>::classOf(node)];
+            ++usage.nodes;
+            usage.bytes += IHTNodeMemoryClasses<NodeType>::footprintOf(node);
+        }
+
+        std::uint32_t allocateNodeId() {
+            if(freeNodeIdCount.load(std::memory_order_relaxed) != 0) {
+                std::lock_guard<std::mutex> lock(freeNodeIdMutex);
+                if(not freeNodeIds.empty()) {
+                    auto const id = freeNodeIds.back();
+                    freeNodeIds.pop_back();
+                    freeNodeIdCount.store(freeNodeIds.size(), std::memory_order_relaxed);
+                    return id;
+                }
+            }
+            auto const id = nodeIdCount.fetch_add(1, std::memory_order_relaxed);
+            assert(id != std::numeric_limits<std::uint32_t>::max());
+            return id;
+        }
+
+        // Requires the mutex of `shard` to be held. Returns whether the node
+        // has been registered.
+        bool removeEntry(Shard &shard, IHT::hash_type hash, IHTNodePtr node) {
+            auto const table = shard.table.load(std::memory_order_relaxed);
+            auto const mask = table->capacity - 1u;
+            for(auto idx = firstSlotOf(hash, table); ; idx = (idx + 1u) & mask) {
+                auto const entry = table->slots[idx].load(std::memory_order_relaxed);
+                if(entry == nullptr) {
+                    // Nodes which lost an insertion race have never been
+                    // registered.
+                    return false;
+                }
+                if(entry != tombstone() and entry->node == node) {
+                    table->slots[idx].store(tombstone(), std::memory_order_release);
+                    --shard.liveEntries;
+                    auto const specialised = static_cast<NodeType const*>(node);
+                    auto &usage = shard.nodeClasses[IHTNodeMemoryClasses<NodeType>::classOf(specialised)];
+                    --usage.nodes;
+                    usage.bytes -= IHTNodeMemoryClasses<NodeType>::footprintOf(specialised);
+                    shard.retired.retire(entry);
+                    return true;
+                }
+            }
+        }
+
+        // Requires the mutex of `shard` to be held. Returns retired objects
+        // that can be destroyed after the mutex has been released.
+        static std::vector<IHT::RetireList::RetiredObject> takeReclaimable(Shard &shard) {
+            if(shard.retired.size() >= reclamationThreshold) {
+                return shard.retired.takeReclaimable();
+            }
+            return {};
+        }
+
+        // Locks the mutex of `shard`, accounting for the time spent waiting
+        // if it is held by another thread.
+        std::unique_lock<std::mutex> lockShard(Shard &shard) {
+            std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+            if(not lock.owns_lock()) {
+                auto const waitStart = std::chrono::steady_clock::now();
+                lock.lock();
+                auto const waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart);
+                statistics.add(CONTENDED_LOCKS);
+                statistics.add(LOCK_WAIT_NANOSECONDS, static_cast<std::uint64_t>(waited.count()));
+            }
+            return lock;
+        }
+
+        // Unregisters the nodes of `disposals`, which all belong to `shard`,
+        // taking the mutex of the shard only once, and disposes of them.
+        void carryOutDisposals(Shard &shard, Disposal const *disposals, std::size_t count) {
+            // Staying pinned keeps retired memory from being reclaimed before
+            // the nodes have been destroyed.
+            auto epochGuard = IHT::EpochManager::get().pin();
+            std::vector<IHT::RetireList::RetiredObject> reclaimable;
+            std::size_t unregistered = 0;
+            {
+                auto shardLock = this->lockShard(shard);
+                std::unique_lock<std::mutex> nodeIdLock(freeNodeIdMutex, std::defer_lock);
+                shard.generation.fetch_add(1, std::memory_order_seq_cst);
+                for(std::size_t idx = 0; idx < count; ++idx) {
+                    if(this->removeEntry(shard, disposals[idx].hash, disposals[idx].node)) {
+                        ++unregistered;
+                        if(not nodeIdLock.owns_lock()) {
+                            nodeIdLock.lock();
+                        }
+                        freeNodeIds.push_back(disposals[idx].node->nodeId);
+                    }
+                    if(disposals[idx].reclaim != nullptr) {
+                        shard.retired.retire(disposals[idx].object, disposals[idx].context, disposals[idx].reclaim);
+                    }
+                }
+                auto const table = shard.table.load(std::memory_order_relaxed);
+                if(table->capacity > minimumTableCapacity and shard.liveEntries * 8u < table->capacity) {
+                    this->rebuildTable(shard, shard.liveEntries);
+                }
+                if(nodeIdLock.owns_lock()) {
+                    freeNodeIdCount.store(freeNodeIds.size(), std::memory_order_relaxed);
+                }
+                reclaimable = takeReclaimable(shard);
             }
-            auto const hash = node->hash();
-            if(nodes.count(hash) > 0) {
-                auto &[nodesWithThisHash, hashMutex] = nodes.at(hash);
-                auto found = std::find_if(nodesWithThisHash.cbegin(),
-                                   nodesWithThisHash.cend(),
-                                   [&node](auto const &ptrNode) {
-                    auto &[ptr, weakPtr] = ptrNode;
-                    return not weakPtr.expired() and node->equal_to(ptr);
-                });
-                if(found != nodesWithThisHash.cend()) {
-                    auto &[_, weakPtr] = *found;
-                    return weakPtr.lock();
+            statistics.add(UNREGISTRATIONS, unregistered);
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                if(disposals[idx].destroy != nullptr) {
+                    disposals[idx].destroy(disposals[idx].object, disposals[idx].context);
                 }
             }
-            return std::nullopt;
+            IHT::RetireList::destroy(std::move(reclaimable));
+        }
+
+        // Set before releasing a node which has never been registered. Its
+        // disposal must not be deferred, as the memory of such a node might
+        // be released as soon as its disposer returns.
+        static bool &disposeNextImmediately() {
+            thread_local bool disposeImmediately = false;
+            return disposeImmediately;
+        }
+
+        // Nodes released on this thread while it disposes of another node.
+        // Disposing of them after that node rather than recursively keeps
+        // tearing down arbitrarily deep expressions in constant stack space.
+        struct DisposalWorklist {
+            bool active = false;
+            std::vector<std::pair<IHTFactory<NodeType>*, Disposal>> disposals;
+        };
+        static DisposalWorklist &localWorklist() {
+            thread_local DisposalWorklist worklist;
+            return worklist;
+        }
+
+        void disposeNode(Disposal const &disposal) {
+            bool const immediately = std::exchange(disposeNextImmediately(), false);
+            if(not immediately and unregistrationMode != IHT::UnregistrationMode::IMMEDIATE) {
+                auto &shard = this->shardOf(disposal.hash);
+                std::lock_guard<std::mutex> disposalLock(shard.disposalMutex);
+                shard.pendingDisposals.push_back(disposal);
+                return;
+            }
+            auto &worklist = localWorklist();
+            if(worklist.active and not immediately) {
+                worklist.disposals.emplace_back(this, disposal);
+                return;
+            }
+            bool const outermost = not worklist.active;
+            worklist.active = true;
+            this->carryOutDisposals(this->shardOf(disposal.hash), &disposal, 1);
+            if(outermost) {
+                // Depth first, which keeps the worklist short for chains
+                while(not worklist.disposals.empty()) {
+                    auto const [factory, next] = worklist.disposals.back();
+                    worklist.disposals.pop_back();
+                    factory->carryOutDisposals(factory->shardOf(next.hash), &next, 1);
+                }
+                worklist.active = false;
+            }
+        }
+
+        void runCollector() {
+            std::unique_lock<std::mutex> lock(collectorMutex);
+            while(not stopCollector) {
+                collectorWakeup.wait_for(lock, collectionInterval);
+                lock.unlock();
+                this->collect();
+                lock.lock();
+            }
+        }
+
+        static std::array<CachedEntry, threadCacheSize> &threadCache() {
+            thread_local std::array<CachedEntry, threadCacheSize> cache{};
+            return cache;
+        }
+
+        static std::size_t cacheSlotOf(IHT::hash_type hash) {
+            hash *= static_cast<IHT::hash_type>(0x9E3779B97F4A7C15ull);
+            return (hash >> (sizeof(IHT::hash_type) * 8u - 16u)) & (threadCacheSize - 1u);
+        }
+
+        // Requires the mutex of `shard` to be held
+        void cacheEntry(Shard const &shard, Entry const *entry) {
+            threadCache()[cacheSlotOf(entry->hash)] = CachedEntry{factoryId, shard.generation.load(std::memory_order_relaxed), entry->hash, entry};
+        }
+
+        // Lock-free. Consults the cache of the calling thread before the
+        // node table.
+        template<typename Predicate>
+        std::optional<IHT::IHTNodePtr<NodeType>> findMatchingNode(IHT::hash_type hash, Predicate const &matches) {
+            auto &shard = this->shardOf(hash);
+            auto epochGuard = IHT::EpochManager::get().pin();
+            // Entries of a shard are only retired after its generation has
+            // been incremented. Thus, a cached entry with the same hash, and
+            // hence of the same shard, has not been retired if the generation
+            // did not change, and it cannot be reclaimed while the epoch is
+            // pinned.
+            auto const generation = shard.generation.load(std::memory_order_seq_cst);
+            auto &cached = threadCache()[cacheSlotOf(hash)];
+            if(cached.factoryId == factoryId and cached.hash == hash and cached.generation == generation) {
+                if(auto acquired = tryAcquire(cached.entry); acquired != nullptr and matches(static_cast<NodeType const*>(cached.entry->node))) {
+                    statistics.add(THREAD_CACHE_HITS);
+                    statistics.add(LOOKUP_HITS);
+                    return acquired;
+                }
+            }
+            Entry const *entry = nullptr;
+            auto found = findMatchingNodeInTable<false>(shard.table.load(std::memory_order_acquire), hash, matches, &entry);
+            if(found.has_value()) {
+                cached = CachedEntry{factoryId, generation, hash, entry};
+                statistics.add(LOOKUP_HITS);
+            } else {
+                statistics.add(LOOKUP_MISSES);
+            }
+            return found;
         }
 
-        // Doing the same as `findEquivalentNodeAssumeLocked` but with mutex
-        // locking. Not just locking in this function and then calling
-        // `findEquivalentNodeAssumeLocked` could be considered a performance
-        // optimisation but is at most a minor one. Doing it anyways and
-        // leaving this comment.
         std::optional<IHT::IHTNodePtr<NodeType>> findEquivalentNode(IHT::IHTNode<NodeType> const *node) {
             if(node == nullptr) {
                 return std::nullopt;
             }
-            auto const hash = node->hash();
-            std::shared_lock<std::shared_mutex> nodesLock(this->nodesMutex);
-            if(nodes.count(hash) > 0) {
-                auto &[nodesWithThisHash, hashMutex] = nodes.at(hash);
-                std::shared_lock<std::shared_mutex> hashLock(hashMutex);
-                auto found = std::find_if(nodesWithThisHash.cbegin(),
-                                   nodesWithThisHash.cend(),
-                                   [&node](auto const &ptrNode) {
-                    auto &[ptr, weakPtr] = ptrNode;
-                    return not weakPtr.expired() and node->equal_to(ptr);
-                });
-                if(found != nodesWithThisHash.cend()) {
-                    auto &[_, weakPtr] = *found;
-                    return weakPtr.lock();
+            return this->findMatchingNode(node->hash(), [node](NodeType const *candidate) {
+                return node->equal_to(candidate);
+            });
+        }
+
+        template<typename Key>
+        std::optional<IHT::IHTNodePtr<NodeType>> findNodeWithKey(Key const &key) {
+            return this->findMatchingNode(key.hash(), [&key](NodeType const *candidate) {
+                return key.equal_to(candidate);
+            });
+        }
+
+        static std::uint64_t nextFactoryId() {
+            static std::atomic<std::uint64_t> factoryCount{0};
+            return factoryCount.fetch_add(1, std::memory_order_relaxed) + 1u;
+        }
+        // Tags are never reused. Once they are exhausted, factories hand out
+        // zero and their nodes are compared structurally.
+        static std::uint32_t nextFactoryTag() {
+            static std::atomic<std::uint32_t> tagCount{0};
+            auto count = tagCount.load(std::memory_order_relaxed);
+            do {
+                if(count == std::numeric_limits<std::uint32_t>::max()) {
+                    return 0;
                 }
-            }
-            return std::nullopt;
+            } while(not tagCount.compare_exchange_weak(count, count + 1u, std::memory_order_relaxed));
+            return count + 1u;
         }
     private: //private members
         static std::unique_ptr<IHT::IHTFactory<NodeType>> singletonInstance;
 
-        std::unordered_map<IHT::hash_type, std::tuple<IHTWeakNodePtrContainer, std::shared_mutex>> nodes;
-        std::shared_mutex nodesMutex;
+        // Identifies the factory in thread caches. Unlike its address, it is
+        // never reused by another factory.
+        std::uint64_t const factoryId = nextFactoryId();
+        // Marks nodes registered with this factory as canonical
+        std::uint32_t const factoryTag = nextFactoryTag();
+
+        // Ids of unregistered nodes are reused before new ones are handed
+        // out. The count of free ids allows to skip the mutex.
+        std::atomic<std::uint32_t> nodeIdCount{0};
+        std::atomic<std::size_t> freeNodeIdCount{0};
+        std::mutex freeNodeIdMutex;
+        std::vector<std::uint32_t> freeNodeIds;
+
+        // Declared before the shards as entries in the shards might hold the
+        // last weak pointers to nodes allocated in the arena.
+        IHT::SlabArena arena;
+        std::size_t const shardCount;
+        std::unique_ptr<Shard[]> const shards;
+        IHT::UnregistrationMode const unregistrationMode;
+
+        // Held for the whole of a collection, so that a collection waits for
+        // the batches another one has already taken from the shards
+        std::mutex collectionMutex;
+
+        // Used if the unregistration mode is BACKGROUND
+        std::mutex collectorMutex;
+        std::condition_variable collectorWakeup;
+        bool stopCollector = false;
+        std::thread collector;
+
+        IHT::StripedCounters<STATISTIC_COUNT> statistics;
+
+        // See getAttachment
+        std::mutex attachmentMutex;
+        std::unordered_map<std::type_index, std::shared_ptr<void>> attachments;
     public:
         static IHTFactory<NodeType> *get() {
             if(singletonInstance == nullptr) {
@@ -158,18 +909,221 @@ namespace IHT {
             return singletonInstance.get();
         }
 
+        // The number of shards is rounded up to the next power of two.
+        // Nodes created without a custom deleter are allocated in an arena
+        // owned by the factory, which may be backed by huge pages.
+        explicit IHTFactory(std::size_t numberOfShards = defaultShardCount,
+                            IHT::ArenaBacking arenaBacking = IHT::ArenaBacking::REGULAR_PAGES,
+                            IHT::UnregistrationMode paramUnregistrationMode = IHT::UnregistrationMode::IMMEDIATE)
+            : arena(arenaBacking),
+              shardCount(roundUpToPowerOfTwo(numberOfShards)),
+              shards(new Shard[shardCount]),
+              unregistrationMode(paramUnregistrationMode) {
+            if(unregistrationMode == IHT::UnregistrationMode::BACKGROUND) {
+                collector = std::thread(&IHTFactory::runCollector, this);
+            }
+        }
+
+        // Pending disposals and retired nodes with a custom deleter are
+        // carried out while all shards still exist, as destroying nodes might
+        // release further nodes.
+        ~IHTFactory() {
+            if(collector.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(collectorMutex);
+                    stopCollector = true;
+                }
+                collectorWakeup.notify_all();
+                collector.join();
+            }
+            bool disposedAny;
+            do {
+                disposedAny = this->collect() > 0;
+                for(std::size_t idx = 0; idx < shardCount; ++idx) {
+                    std::vector<IHT::RetireList::RetiredObject> retired;
+                    {
+                        std::lock_guard<std::mutex> shardLock(shards[idx].mutex);
+                        retired = shards[idx].retired.takeAll();
+                    }
+                    disposedAny = disposedAny or not retired.empty();
+                    IHT::RetireList::destroy(std::move(retired));
+                }
+            } while(disposedAny);
+        }
+
+        // Exceeds the ids of all nodes registered with this factory
+        std::uint32_t nodeIdBound() const {
+            return nodeIdCount.load(std::memory_order_relaxed);
+        }
+
+        IHT::UnregistrationMode getUnregistrationMode() const {
+            return unregistrationMode;
+        }
+
+        // The object of type `Attachment` attached to this factory, which is
+        // default constructed on first use. Lets all users of the factory
+        // share state belonging to its nodes, e.g. the counters of
+        // libexpressions::ExpressionFactory::makeNewIdentifier. Thread-safe.
+        template<typename Attachment>
+        std::shared_ptr<Attachment> getAttachment() {
+            std::lock_guard<std::mutex> lock(attachmentMutex);
+            auto &attachment = attachments[std::type_index(typeid(Attachment))];
+            if(attachment == nullptr) {
+                attachment = std::make_shared<Attachment>();
+            }
+            return std::static_pointer_cast<Attachment>(attachment);
+        }
+
+        // Unregisters and destroys the nodes released since the last
+        // collection, including the nodes released by destroying them, and
+        // returns their number. Only necessary if the unregistration mode is
+        // DEFERRED. May be called concurrently with any other member function;
+        // concurrent collections, including those of the background collector,
+        // are carried out one after another, so the nodes released before the
+        // call are unregistered once it returns. Must not be called from the
+        // destructor of a node of this factory.
+        std::size_t collect() {
+            std::lock_guard<std::mutex> collectionLock(collectionMutex);
+            std::size_t collected = 0;
+            std::vector<Disposal> batch;
+            bool foundAny;
+            do {
+                foundAny = false;
+                for(std::size_t idx = 0; idx < shardCount; ++idx) {
+                    {
+                        std::lock_guard<std::mutex> disposalLock(shards[idx].disposalMutex);
+                        batch.swap(shards[idx].pendingDisposals);
+                    }
+                    if(batch.empty()) {
+                        continue;
+                    }
+                    this->carryOutDisposals(shards[idx], batch.data(), batch.size());
+                    collected += batch.size();
+                    foundAny = true;
+                    batch.clear();
+                }
+            } while(foundAny);
+            return collected;
+        }
+
+        std::size_t getShardCount() const {
+            return shardCount;
+        }
+
+        // Takes the mutex of every shard in turn to inspect its table, which
+        // is cheap enough for monitoring but not meant for hot paths. The
+        // event counters are maintained at all times.
+        IHT::IHTFactoryStatistics stats() const {
+            IHT::IHTFactoryStatistics result;
+            result.shards = shardCount;
+            std::size_t totalProbeLength = 0;
+            for(std::size_t idx = 0; idx < shardCount; ++idx) {
+                auto &shard = shards[idx];
+                {
+                    std::lock_guard<std::mutex> shardLock(shard.mutex);
+                    auto const table = shard.table.load(std::memory_order_relaxed);
+                    auto const mask = table->capacity - 1u;
+                    result.liveNodes += shard.liveEntries;
+                    result.tableSlots += table->capacity;
+                    result.usedSlots += shard.usedSlots;
+                    // Clusters may wrap around the end of the table, so
+                    // start scanning behind an empty slot
+                    std::size_t start = 0;
+                    while(start < table->capacity and table->slots[start].load(std::memory_order_relaxed) != nullptr) {
+                        ++start;
+                    }
+                    std::size_t clusterLength = 0;
+                    for(std::size_t offset = 1; offset <= table->capacity; ++offset) {
+                        auto const slot = (start + offset) & mask;
+                        auto entry = table->slots[slot].load(std::memory_order_relaxed);
+                        if(entry == nullptr) {
+                            if(clusterLength > 0) {
+                                result.clusterLengths.add(clusterLength);
+                                clusterLength = 0;
+                            }
+                            continue;
+                        }
+                        ++clusterLength;
+                        if(entry != tombstone()) {
+                            auto const probeLength = ((slot - firstSlotOf(entry->hash, table)) & mask) + 1u;
+                            result.maxProbeLength = std::max(result.maxProbeLength, probeLength);
+                            result.probeLengths.add(probeLength);
+                            totalProbeLength += probeLength;
+                        }
+                    }
+                    if(clusterLength > 0) {
+                        result.clusterLengths.add(clusterLength);
+                    }
+                }
+                std::lock_guard<std::mutex> disposalLock(shard.disposalMutex);
+                result.pendingDisposals += shard.pendingDisposals.size();
+            }
+            if(result.liveNodes > 0) {
+                result.meanProbeLength = static_cast<double>(totalProbeLength) / static_cast<double>(result.liveNodes);
+            }
+            result.lookupHits = statistics.sum(LOOKUP_HITS);
+            result.lookupMisses = statistics.sum(LOOKUP_MISSES);
+            result.threadCacheHits = statistics.sum(THREAD_CACHE_HITS);
+            result.insertions = statistics.sum(INSERTIONS);
+            result.insertionRacesLost = statistics.sum(INSERTION_RACES_LOST);
+            result.unregistrations = statistics.sum(UNREGISTRATIONS);
+            result.contendedLocks = statistics.sum(CONTENDED_LOCKS);
+            result.lockWaitNanoseconds = statistics.sum(LOCK_WAIT_NANOSECONDS);
+            return result;
+        }
+
+        // Like `stats`, takes the mutex of every shard in turn, but reads
+        // counters maintained while registering and unregistering nodes
+        // rather than inspecting tables or nodes.
+        IHT::IHTFactoryMemoryReport memoryReport() const {
+            IHT::IHTFactoryMemoryReport result;
+            result.nodeClasses.resize(IHTNodeMemoryClasses<NodeType>::count);
+            for(std::size_t idx = 0; idx < shardCount; ++idx) {
+                auto &shard = shards[idx];
+                std::lock_guard<std::mutex> shardLock(shard.mutex);
+                auto const table = shard.table.load(std::memory_order_relaxed);
+                result.liveNodes += shard.liveEntries;
+                result.tableBytes += sizeof(Table) + table->capacity * sizeof(std::atomic<Entry*>);
+                result.entryBytes += shard.liveEntries * sizeof(Entry);
+                for(std::size_t nodeClass = 0; nodeClass < shard.nodeClasses.size(); ++nodeClass) {
+                    result.nodeClasses[nodeClass].nodes += shard.nodeClasses[nodeClass].nodes;
+                    result.nodeClasses[nodeClass].bytes += shard.nodeClasses[nodeClass].bytes;
+                }
+            }
+            result.arenaReservedBytes = arena.reservedBytes();
+            result.arenaUsedBytes = arena.usedBytes();
+            result.controlBlockBytes = result.liveNodes * controlBlockReserve;
+            result.freeNodeIdBytes = freeNodeIdCount.load(std::memory_order_relaxed) * sizeof(std::uint32_t);
+            return result;
+        }
+
         //Constructors and destructors of NodeType should not have side effects
         //as temporary objects are created and might be destroyed.
         template<typename SpecialisedType, class ... Args>
         std::optional<IHT::IHTNodePtr<NodeType>> tryCreateNewNode(Args&& ...args) {
-            return this->tryCreateNewNodeWithDeleter<SpecialisedType>(std::default_delete<NodeType>{}, std::forward<Args>(args)...);
+            static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            auto node = this->constructInArena<SpecialisedType>(std::forward<Args>(args)...);
+            auto const newNodePtr = node.get();
+            auto inserted = this->findOrInsertNode(std::move(node), [this](auto &&candidate) {
+                return this->adoptArenaNode(std::move(candidate));
+            });
+            if(newNodePtr == inserted.get()) {
+                return inserted;
+            } else {
+                return std::nullopt;
+            }
         }
 
         //Constructors and destructors of NodeType should not have side effects
         //as temporary objects are created and might be destroyed.
         template<typename SpecialisedType, class ... Args>
         IHT::IHTNodePtr<NodeType> createNode(Args&& ...args) {
-            return this->createNodeWithDeleter<SpecialisedType>(std::default_delete<NodeType>{}, std::forward<Args>(args)...);
+            static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            return this->findOrInsertNode(this->constructInArena<SpecialisedType>(std::forward<Args>(args)...), [this](auto &&candidate) {
+                return this->adoptArenaNode(std::move(candidate));
+            });
         }
 
         //Constructors and destructors of NodeType should not have side effects
@@ -183,12 +1137,12 @@ namespace IHT {
         std::optional<IHT::IHTNodePtr<NodeType>> tryCreateNewNodeWithDeleter(Deleter &&deleter, Args&& ...args) {
             static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
             static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(not HasTrailingStorage<SpecialisedType>::value, "IHTFactory cannot create objects with trailing storage outside of its arena.");
 
             //Create a node with the given arguments
             auto newNodePtr = new SpecialisedType(std::forward<Args>(args)...);
-            //Create a node with the given arguments
-            auto inserted = this->findOrInsertNode(std::unique_ptr<SpecialisedType, deleter_type<Deleter>>(newNodePtr,
-                                    this->getNodeDeleter(std::forward<Deleter>(deleter))));
+            auto inserted = this->findOrInsertNode(std::unique_ptr<SpecialisedType, std::decay_t<Deleter>>(newNodePtr, deleter),
+                                                   this->adoptWithDeleter(std::forward<Deleter>(deleter)));
             if(newNodePtr == inserted.get()) {
                 return inserted;
             } else {
@@ -207,9 +1161,160 @@ namespace IHT {
         IHT::IHTNodePtr<NodeType> createNodeWithDeleter(Deleter &&deleter, Args&& ...args) {
             static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
             static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(not HasTrailingStorage<SpecialisedType>::value, "IHTFactory cannot create objects with trailing storage outside of its arena.");
             //Create a node with the given arguments
-            return this->findOrInsertNode(std::unique_ptr<SpecialisedType, deleter_type<Deleter>>(new SpecialisedType(std::forward<Args>(args)...),
-                                          this->getNodeDeleter(std::forward<Deleter>(deleter))));
+            return this->findOrInsertNode(std::unique_ptr<SpecialisedType, std::decay_t<Deleter>>(new SpecialisedType(std::forward<Args>(args)...), deleter),
+                                          this->adoptWithDeleter(std::forward<Deleter>(deleter)));
+        }
+
+        //Looks for an existing node using a lookup key before constructing
+        //anything. `Key` has to provide `hash()`, returning the hash an
+        //equivalent node would have, and `equal_to(NodeType const*)`. Only if
+        //there is no equivalent node, a node is constructed from `args`.
+        template<typename SpecialisedType, typename Key, class ... Args>
+        IHT::IHTNodePtr<NodeType> createNodeWithKey(Key const &key, Args&& ...args) {
+            static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            if(auto existing = this->findNodeWithKey(key); existing.has_value()) {
+                return existing.value();
+            }
+            auto node = this->constructInArena<SpecialisedType>(std::forward<Args>(args)...);
+            assert(node->hash() == key.hash());
+            return this->insertNode(std::move(node), [this](auto &&candidate) {
+                return this->adoptArenaNode(std::move(candidate));
+            });
+        }
+
+        //Like `createNodeWithKey`, but only returns a node if it has been
+        //newly created.
+        template<typename SpecialisedType, typename Key, class ... Args>
+        std::optional<IHT::IHTNodePtr<NodeType>> tryCreateNewNodeWithKey(Key const &key, Args&& ...args) {
+            static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            if(this->findNodeWithKey(key).has_value()) {
+                return std::nullopt;
+            }
+            auto node = this->constructInArena<SpecialisedType>(std::forward<Args>(args)...);
+            assert(node->hash() == key.hash());
+            auto const newNodePtr = node.get();
+            auto inserted = this->insertNode(std::move(node), [this](auto &&candidate) {
+                return this->adoptArenaNode(std::move(candidate));
+            });
+            if(newNodePtr == inserted.get()) {
+                return inserted;
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        //Interns a batch of `count` nodes, none of which may be an operand
+        //of another one, and returns the canonical nodes in the order of the
+        //batch. Node `idx` is looked up with `keyOf(idx)` like in
+        //`createNodeWithKey` and only constructed from the tuple returned by
+        //`argumentsOf(idx)` if there is no equivalent node. Nodes which have
+        //been constructed are grouped by shard and registered taking the
+        //mutex of every shard once. Lookups and registration are split into
+        //tasks run by `executor`, see IHT::SequentialExecutor; if it runs
+        //them in parallel, `keyOf` and `argumentsOf` are called
+        //concurrently.
+        template<typename SpecialisedType, typename KeyOf, typename ArgumentsOf, typename Executor = IHT::SequentialExecutor>
+        std::vector<IHT::IHTNodePtr<NodeType>> createNodesWithKeys(std::size_t count, KeyOf const &keyOf, ArgumentsOf const &argumentsOf,
+                                                                  Executor &&executor = Executor()) {
+            static_assert(std::is_base_of<IHT::IHTNode<NodeType>, NodeType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            static_assert(std::is_base_of<NodeType, SpecialisedType>::value == true, "IHTFactory cannot create objects of types not derived from IHTNode.");
+            std::vector<IHT::IHTNodePtr<NodeType>> result(count);
+            std::vector<std::unique_ptr<SpecialisedType, ArenaNodeDeleter<SpecialisedType>>> constructed(count);
+            auto const lookupTaskCount = (count + bulkLookupTaskSize - 1u) / bulkLookupTaskSize;
+            executor(lookupTaskCount, [&](std::size_t task) {
+                auto const last = std::min(count, (task + 1u) * bulkLookupTaskSize);
+                for(auto idx = task * bulkLookupTaskSize; idx < last; ++idx) {
+                    auto const key = keyOf(idx);
+                    if(auto existing = this->findNodeWithKey(key); existing.has_value()) {
+                        result[idx] = std::move(existing).value();
+                    } else {
+                        constructed[idx] = std::apply([this](auto&& ...args) {
+                            return this->constructInArena<SpecialisedType>(std::forward<decltype(args)>(args)...);
+                        }, argumentsOf(idx));
+                        assert(constructed[idx]->hash() == key.hash());
+                    }
+                }
+            });
+            // Counting sort of the constructed nodes by shard
+            std::vector<std::size_t> shardBegins(shardCount + 1u, 0);
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                if(constructed[idx] != nullptr) {
+                    ++shardBegins[this->shardIndexOf(constructed[idx]->hash()) + 1u];
+                }
+            }
+            std::partial_sum(shardBegins.begin(), shardBegins.end(), shardBegins.begin());
+            std::vector<std::size_t> byShard(shardBegins.back());
+            std::vector<std::size_t> shardEnds(shardBegins.begin(), shardBegins.end() - 1);
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                if(constructed[idx] != nullptr) {
+                    byShard[shardEnds[this->shardIndexOf(constructed[idx]->hash())]++] = idx;
+                }
+            }
+            // Small batches touch few shards and should not pay for the rest
+            std::vector<std::size_t> occupiedShards;
+            for(std::size_t shardIdx = 0; shardIdx < shardCount; ++shardIdx) {
+                if(shardBegins[shardIdx] != shardBegins[shardIdx + 1u]) {
+                    occupiedShards.push_back(shardIdx);
+                }
+            }
+            executor(occupiedShards.size(), [&](std::size_t task) {
+                auto const shardIdx = occupiedShards[task];
+                auto const first = byShard.begin() + static_cast<std::ptrdiff_t>(shardBegins[shardIdx]);
+                auto const last = byShard.begin() + static_cast<std::ptrdiff_t>(shardBegins[shardIdx + 1u]);
+                std::vector<IHT::IHTNodePtr<NodeType>> candidates;
+                candidates.reserve(static_cast<std::size_t>(last - first));
+                for(auto idx = first; idx != last; ++idx) {
+                    candidates.push_back(this->adoptArenaNode(std::move(constructed[*idx])));
+                }
+                auto &shard = shards[shardIdx];
+                std::size_t inserted = 0;
+                {
+                    auto shardLock = this->lockShard(shard);
+                    for(std::size_t candidate = 0; candidate < candidates.size(); ++candidate) {
+                        auto &toInsert = candidates[candidate];
+                        auto const hash = toInsert->hash();
+                        // Equivalent nodes might have been inserted by other
+                        // threads or earlier in the batch
+                        if(auto concurrentNode = findEquivalentNodeInTable<true>(shard.table.load(std::memory_order_relaxed), hash, toInsert.get())) {
+                            result[first[static_cast<std::ptrdiff_t>(candidate)]] = std::move(concurrentNode).value();
+                            continue;
+                        }
+                        auto const registered = const_cast<IHT::IHTNode<NodeType>*>(toInsert.get());
+                        registered->factoryTag = factoryTag;
+                        registered->nodeId = this->allocateNodeId();
+                        auto const entry = makeEntry(toInsert);
+                        this->insertEntry(shard, entry);
+                        this->cacheEntry(shard, entry);
+                        result[first[static_cast<std::ptrdiff_t>(candidate)]] = std::move(toInsert);
+                        ++inserted;
+                    }
+                }
+                statistics.add(INSERTIONS, inserted);
+                statistics.add(INSERTION_RACES_LOST, candidates.size() - inserted);
+                // Releasing nodes which lost requires the mutex
+                for(auto &candidate : candidates) {
+                    if(candidate != nullptr) {
+                        disposeNextImmediately() = true;
+                        candidate.reset();
+                    }
+                }
+            });
+            return result;
+        }
+
+        template<typename Key>
+        bool hasNodeWithKey(Key const &key) {
+            return this->findNodeWithKey(key).has_value();
+        }
+
+        // Whether `node` is registered with this factory. Never true once
+        // the factory tags are exhausted, see nextFactoryTag.
+        bool owns(IHT::IHTNode<NodeType> const *node) const {
+            return factoryTag != 0 and node->factoryTag == factoryTag;
         }
 
         bool hasEquivalentNode(IHT::IHTNode<NodeType> const *node) {
@@ -224,31 +1329,51 @@ namespace IHT {
 
     // Implementation of long methods from class template
     template<typename NodeType>
-    template<typename SpecialisedType, typename Deleter>
-    IHT::IHTNodePtr<NodeType> IHTFactory<NodeType>::findOrInsertNode(std::unique_ptr<SpecialisedType, Deleter> &&node) {
+    template<typename SpecialisedType, typename Deleter, typename Adopter>
+    IHT::IHTNodePtr<NodeType> IHTFactory<NodeType>::findOrInsertNode(std::unique_ptr<SpecialisedType, Deleter> &&node, Adopter &&adopt) {
         if(node == nullptr) {
             return nullptr;
         }
         //If no node was found, insert the created node into the node map
-        //and return the pointer
+        //and return the pointer. Otherwise, the created node is destroyed
+        //without ever having been registered.
         if(auto eqNode = this->findEquivalentNode(node.get());
             not eqNode.has_value()) {
-            IHT::IHTNodePtr<NodeType> toInsert(node.get(), node.get_deleter());
-            node.release();
-            auto const hash = toInsert->hash();
-            std::unique_lock<std::shared_mutex> nodesLock(this->nodesMutex);
-            auto &[ptrs, hashMutex] = nodes[hash];
-            {
-                std::unique_lock<std::shared_mutex> hashLock(hashMutex);
-                if(not this->findEquivalentNodeAssumeLocked(node.get()).has_value()) {
-                    ptrs.emplace_back(toInsert.get(), toInsert);
-                }
-            }
-            assert(this->findEquivalentNodeAssumeLocked(toInsert.get()).has_value());
-            return toInsert;
+            return this->insertNode(std::move(node), std::forward<Adopter>(adopt));
         } else {
             return eqNode.value();
         }
     }
-}
 
+    template<typename NodeType>
+    template<typename SpecialisedType, typename Deleter, typename Adopter>
+    IHT::IHTNodePtr<NodeType> IHTFactory<NodeType>::insertNode(std::unique_ptr<SpecialisedType, Deleter> &&node, Adopter &&adopt) {
+        IHT::IHTNodePtr<NodeType> toInsert = adopt(std::move(node));
+        auto const hash = toInsert->hash();
+        auto &shard = this->shardOf(hash);
+        std::optional<IHT::IHTNodePtr<NodeType>> concurrentNode;
+        {
+            auto shardLock = this->lockShard(shard);
+            // Another thread might have inserted an equivalent node since we
+            // looked for one.
+            concurrentNode = findEquivalentNodeInTable<true>(shard.table.load(std::memory_order_relaxed), hash, toInsert.get());
+            if(not concurrentNode.has_value()) {
+                // The node is not visible to other threads yet
+                auto const registered = const_cast<IHT::IHTNode<NodeType>*>(toInsert.get());
+                registered->factoryTag = factoryTag;
+                registered->nodeId = this->allocateNodeId();
+                auto const entry = makeEntry(toInsert);
+                this->insertEntry(shard, entry);
+                this->cacheEntry(shard, entry);
+                assert(findEquivalentNodeInTable<true>(shard.table.load(std::memory_order_relaxed), hash, toInsert.get()).has_value());
+                statistics.add(INSERTIONS);
+                return toInsert;
+            }
+        }
+        statistics.add(INSERTION_RACES_LOST);
+        // Releasing `toInsert` requires the mutex
+        disposeNextImmediately() = true;
+        toInsert.reset();
+        return concurrentNode.value();
+    }
+}
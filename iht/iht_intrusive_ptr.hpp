@@ -0,0 +1,194 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace IHT {
+    template<typename NodeType>
+    class IHTNode;
+
+    template<typename NodeType>
+    void acquireNodeReference(IHT::IHTNode<NodeType> const *node) noexcept;
+    template<typename NodeType>
+    bool tryAcquireNodeReference(IHT::IHTNode<NodeType> const *node) noexcept;
+    template<typename NodeType>
+    void releaseNodeReference(IHT::IHTNode<NodeType> const *node);
+
+    // Pointer sharing ownership of an IHT node through a reference count
+    // stored in the node itself. Compared to std::shared_ptr, it is half the
+    // size and nodes do not need a separate control block. It provides the
+    // part of the interface of std::shared_ptr used with IHT nodes.
+    template<typename T>
+    class IHTIntrusivePtr {
+        template<typename U>
+        friend class IHTIntrusivePtr;
+    public:
+        typedef T element_type;
+    private:
+        T *ptr = nullptr;
+
+        struct AdoptReference {};
+        IHTIntrusivePtr(T *paramPtr, AdoptReference) noexcept : ptr(paramPtr) { }
+    public:
+        constexpr IHTIntrusivePtr() noexcept = default;
+        constexpr IHTIntrusivePtr(std::nullptr_t) noexcept { }
+        // `paramPtr` has to point to a node whose reference count is not zero
+        // or which has just been created.
+        explicit IHTIntrusivePtr(T *paramPtr) noexcept : ptr(paramPtr) {
+            if(ptr != nullptr) {
+                IHT::acquireNodeReference(ptr);
+            }
+        }
+        IHTIntrusivePtr(IHTIntrusivePtr const &other) noexcept : IHTIntrusivePtr(other.ptr) { }
+        IHTIntrusivePtr(IHTIntrusivePtr &&other) noexcept : ptr(std::exchange(other.ptr, nullptr)) { }
+        template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+        IHTIntrusivePtr(IHTIntrusivePtr<U> const &other) noexcept : IHTIntrusivePtr(other.ptr) { }
+        template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+        IHTIntrusivePtr(IHTIntrusivePtr<U> &&other) noexcept : ptr(std::exchange(other.ptr, nullptr)) { }
+        ~IHTIntrusivePtr() {
+            if(ptr != nullptr) {
+                IHT::releaseNodeReference(ptr);
+            }
+        }
+
+        IHTIntrusivePtr &operator=(IHTIntrusivePtr other) noexcept {
+            this->swap(other);
+            return *this;
+        }
+
+        // Acquires a reference to `paramPtr` unless its reference count has
+        // already dropped to zero, i.e. unless it is about to be destroyed.
+        static IHTIntrusivePtr tryAcquire(T *paramPtr) noexcept {
+            if(paramPtr != nullptr and IHT::tryAcquireNodeReference(paramPtr)) {
+                return IHTIntrusivePtr(paramPtr, AdoptReference{});
+            }
+            return nullptr;
+        }
+
+        void reset() noexcept {
+            IHTIntrusivePtr().swap(*this);
+        }
+        void swap(IHTIntrusivePtr &other) noexcept {
+            std::swap(ptr, other.ptr);
+        }
+
+        T *get() const noexcept {
+            return ptr;
+        }
+        T &operator*() const noexcept {
+            return *ptr;
+        }
+        T *operator->() const noexcept {
+            return ptr;
+        }
+        explicit operator bool() const noexcept {
+            return ptr != nullptr;
+        }
+    };
+
+    template<typename T, typename U>
+    bool operator==(IHTIntrusivePtr<T> const &lhs, IHTIntrusivePtr<U> const &rhs) noexcept {
+        return lhs.get() == rhs.get();
+    }
+    template<typename T, typename U>
+    bool operator!=(IHTIntrusivePtr<T> const &lhs, IHTIntrusivePtr<U> const &rhs) noexcept {
+        return lhs.get() != rhs.get();
+    }
+    template<typename T, typename U>
+    bool operator<(IHTIntrusivePtr<T> const &lhs, IHTIntrusivePtr<U> const &rhs) noexcept {
+        return std::less<>{}(lhs.get(), rhs.get());
+    }
+    template<typename T>
+    bool operator==(IHTIntrusivePtr<T> const &lhs, std::nullptr_t) noexcept {
+        return lhs.get() == nullptr;
+    }
+    template<typename T>
+    bool operator==(std::nullptr_t, IHTIntrusivePtr<T> const &rhs) noexcept {
+        return rhs.get() == nullptr;
+    }
+    template<typename T>
+    bool operator!=(IHTIntrusivePtr<T> const &lhs, std::nullptr_t) noexcept {
+        return lhs.get() != nullptr;
+    }
+    template<typename T>
+    bool operator!=(std::nullptr_t, IHTIntrusivePtr<T> const &rhs) noexcept {
+        return rhs.get() != nullptr;
+    }
+
+    template<typename T, typename U>
+    IHTIntrusivePtr<T> static_pointer_cast(IHTIntrusivePtr<U> const &ptr) noexcept {
+        return IHTIntrusivePtr<T>(static_cast<T*>(ptr.get()));
+    }
+
+    // Functions disposing of nodes whose reference count dropped to zero.
+    // Nodes store the index of their disposer instead of a function pointer
+    // to keep the node header small.
+    template<typename NodeType>
+    class IHTNodeDisposers {
+    public:
+        typedef void (*Disposer)(IHT::IHTNode<NodeType> const *node, void *context);
+    private:
+        static constexpr std::size_t capacity = 256;
+
+        static std::array<std::atomic<Disposer>, capacity> &disposers() {
+            static std::array<std::atomic<Disposer>, capacity> instance{};
+            return instance;
+        }
+
+        static std::uint32_t add(Disposer disposer) {
+            static std::atomic<std::uint32_t> count{0};
+            auto const index = count.fetch_add(1, std::memory_order_relaxed);
+            if(index >= capacity) {
+                throw std::runtime_error("Too many different IHT node disposers.");
+            }
+            disposers()[index].store(disposer, std::memory_order_release);
+            return index;
+        }
+    public:
+        template<Disposer disposer>
+        static std::uint32_t indexOf() {
+            static std::uint32_t const index = add(disposer);
+            return index;
+        }
+
+        static void dispose(std::uint32_t index, IHT::IHTNode<NodeType> const *node, void *context) {
+            disposers()[index].load(std::memory_order_acquire)(node, context);
+        }
+    };
+}
+
+namespace std {
+    template<typename T> struct hash<IHT::IHTIntrusivePtr<T>> {
+        std::size_t operator()(IHT::IHTIntrusivePtr<T> const &ptr) const noexcept {
+            return std::hash<T*>{}(ptr.get());
+        }
+    };
+}
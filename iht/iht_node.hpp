@@ -23,8 +23,14 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <limits>
+
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+#include "libexpressions/iht/iht_intrusive_ptr.hpp"
+#endif
 
 // namespace for IHT (Immutable Hashed Tree)
 namespace IHT {
@@ -37,10 +43,40 @@ namespace IHT {
         friend class IHTFactory<NodeType>;
     public:
         typedef NodeType node_type;
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+    private:
+        friend void IHT::acquireNodeReference<NodeType>(IHT::IHTNode<NodeType> const *node) noexcept;
+        friend bool IHT::tryAcquireNodeReference<NodeType>(IHT::IHTNode<NodeType> const *node) noexcept;
+        friend void IHT::releaseNodeReference<NodeType>(IHT::IHTNode<NodeType> const *node);
+        // Set up by the factory. All of these are trivially destructible and
+        // stay readable until the memory of a destroyed node is reclaimed, as
+        // lock-free lookups might still inspect the reference count.
+        mutable std::atomic<std::uint32_t> referenceCount{0};
+        std::uint32_t disposer = 0;
+        void *disposalContext = nullptr;
+#endif
+    private:
+        // Tag of the factory the node is registered with or zero and the id
+        // of the node within that factory. Set once before the node is
+        // published.
+        std::uint32_t factoryTag = 0;
+        std::uint32_t nodeId = std::numeric_limits<std::uint32_t>::max();
     protected:
         IHTNode() = default;
     public:
         ~IHTNode() = default;
+        // A factory holds at most one node of every equivalence class, so
+        // nodes registered with the same factory are equivalent only if
+        // they are identical.
+        bool isCanonicalWith(IHT::IHTNode<node_type> const *other) const {
+            return factoryTag != 0 and factoryTag == other->factoryTag;
+        }
+        // Ids are dense among the nodes registered with a factory and
+        // bounded by IHTFactory::nodeIdBound, so they may index side tables.
+        // The id of an unregistered node is handed out again.
+        std::uint32_t getNodeId() const {
+            return nodeId;
+        }
         IHT::hash_type hash() const {
             return static_cast<node_type const*>(this)->hash();
         }
@@ -52,8 +88,40 @@ namespace IHT {
         }
     };
 
+#ifdef LIBEXPRESSIONS_INTRUSIVE_NODE_PTR
+    template<typename NodeType>
+    void acquireNodeReference(IHT::IHTNode<NodeType> const *node) noexcept {
+        node->referenceCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    template<typename NodeType>
+    bool tryAcquireNodeReference(IHT::IHTNode<NodeType> const *node) noexcept {
+        auto count = node->referenceCount.load(std::memory_order_relaxed);
+        do {
+            if(count == 0) {
+                return false;
+            }
+        } while(not node->referenceCount.compare_exchange_weak(count, count + 1u, std::memory_order_acquire, std::memory_order_relaxed));
+        return true;
+    }
+    template<typename NodeType>
+    void releaseNodeReference(IHT::IHTNode<NodeType> const *node) {
+        if(node->referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1u) {
+            IHT::IHTNodeDisposers<NodeType>::dispose(node->disposer, node, node->disposalContext);
+        }
+    }
+
+    // Pointer type used for nodes and pointers to types derived from them
+    template<typename T>
+    using IHTPtr = IHT::IHTIntrusivePtr<T>;
+#else
+    // Pointer type used for nodes and pointers to types derived from them
+    template<typename T>
+    using IHTPtr = std::shared_ptr<T>;
+    using std::static_pointer_cast;
+#endif
+
     template<typename NodeType>
-    using IHTNodePtr = std::shared_ptr<IHT::IHTNode<NodeType> const>;
+    using IHTNodePtr = IHT::IHTPtr<IHT::IHTNode<NodeType> const>;
 
     template<typename NodeType>
     IHT::hash_type hashof(IHT::IHTNode<NodeType> const &node) {
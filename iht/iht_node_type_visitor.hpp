@@ -33,7 +33,7 @@ namespace IHT {
         auto operator()(Fn &&f, Node const *node) const
         -> typename std::result_of<Fn(T const*)>::type {
             assert(dynamic_cast<T const*>(node));
-            return f(dynamic_cast<T const*>(node));
+            return f(static_cast<T const*>(node));
         }
     };
     template<typename T, typename Fn, typename Node>
@@ -0,0 +1,226 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace IHT {
+    enum class ArenaBacking {
+        REGULAR_PAGES,
+        HUGE_PAGES
+    };
+
+    // An arena handing out memory in size classes of 16 bytes. Memory is
+    // carved from large blocks, so objects allocated one after the other end
+    // up next to each other. Freed memory is kept in per size class free
+    // lists and reused for allocations of the same size class; blocks are
+    // only returned to the system when the arena is destroyed.
+    // To keep threads from contending, the arena consists of several heaps
+    // and every thread allocates from its own heap. Memory may be freed by
+    // any thread and is returned to the heap it was allocated from.
+    class SlabArena {
+    public:
+        static constexpr std::size_t granularity = alignof(std::max_align_t) > 16u ? alignof(std::max_align_t) : 16u;
+        static constexpr std::size_t maximumSlabSize = 512;
+    private:
+        static constexpr std::size_t sizeClassCount = maximumSlabSize / granularity;
+        static constexpr std::size_t regularBlockSize = std::size_t(1) << 16u;
+        static constexpr std::size_t hugeBlockSize = std::size_t(1) << 21u;
+
+        struct alignas(64) Heap {
+            std::mutex mutex;
+            std::array<void*, sizeClassCount> freeLists{};
+            char *bumpPointer = nullptr;
+            char *bumpEnd = nullptr;
+            // Bytes of the slots handed out. Only written while holding
+            // `mutex`, but read without it.
+            std::atomic<std::size_t> usedBytes{0};
+        };
+        // Placed at the beginning of every block to find the owning heap
+        struct alignas(64) BlockHeader {
+            Heap *heap;
+        };
+
+        ArenaBacking const backing;
+        std::size_t const blockSize;
+        std::size_t const heapCount;
+        std::unique_ptr<Heap[]> const heaps;
+        std::mutex blocksMutex;
+        std::vector<void*> blocks;
+        std::atomic<std::size_t> blockBytes{0};
+        // Allocations exceeding `maximumSlabSize`
+        std::atomic<std::size_t> oversizedBytes{0};
+
+        static std::size_t sizeClassOf(std::size_t size) {
+            return (size + granularity - 1u) / granularity - 1u;
+        }
+
+        static std::size_t defaultHeapCount() {
+            std::size_t count = 1;
+            auto const threads = std::max(1u, std::thread::hardware_concurrency());
+            while(count < threads and count < 64u) {
+                count <<= 1u;
+            }
+            return count;
+        }
+
+        Heap &localHeap() const {
+            static std::atomic<std::size_t> nextThreadIndex{0};
+            thread_local std::size_t const threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+            return heaps[threadIndex & (heapCount - 1u)];
+        }
+
+        void *allocateBlock() {
+            void *block = nullptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if(backing == ArenaBacking::HUGE_PAGES) {
+                // Over-allocate to be able to align the block to its size,
+                // which is required for the kernel to back it by huge pages.
+                auto const mapped = mmap(nullptr, 2u * blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(mapped == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                auto const address = reinterpret_cast<std::uintptr_t>(mapped);
+                auto const aligned = (address + blockSize - 1u) & ~(blockSize - 1u);
+                if(aligned != address) {
+                    munmap(mapped, aligned - address);
+                }
+                munmap(reinterpret_cast<void*>(aligned + blockSize), address + blockSize - aligned);
+                block = reinterpret_cast<void*>(aligned);
+                madvise(block, blockSize, MADV_HUGEPAGE);
+            }
+#endif
+            if(block == nullptr) {
+                block = ::operator new(blockSize, std::align_val_t(blockSize));
+            }
+            std::lock_guard<std::mutex> lock(blocksMutex);
+            blocks.push_back(block);
+            blockBytes.fetch_add(blockSize, std::memory_order_relaxed);
+            return block;
+        }
+
+        void freeBlock(void *block) const {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if(backing == ArenaBacking::HUGE_PAGES) {
+                munmap(block, blockSize);
+                return;
+            }
+#endif
+            ::operator delete(block, std::align_val_t(blockSize));
+        }
+    public:
+        explicit SlabArena(ArenaBacking paramBacking = ArenaBacking::REGULAR_PAGES)
+            : backing(paramBacking),
+              blockSize(paramBacking == ArenaBacking::HUGE_PAGES ? hugeBlockSize : regularBlockSize),
+              heapCount(defaultHeapCount()),
+              heaps(new Heap[heapCount]) { }
+        SlabArena(SlabArena const &) = delete;
+        SlabArena &operator=(SlabArena const &) = delete;
+        ~SlabArena() {
+            for(auto block : blocks) {
+                this->freeBlock(block);
+            }
+        }
+
+        ArenaBacking getBacking() const {
+            return backing;
+        }
+
+        // Rounds `size` up to the size actually used for allocations of it
+        static constexpr std::size_t slotSizeOf(std::size_t size) {
+            return (size + granularity - 1u) / granularity * granularity;
+        }
+
+        void *allocate(std::size_t size) {
+            if(size > maximumSlabSize) {
+                auto const memory = ::operator new(size);
+                oversizedBytes.fetch_add(size, std::memory_order_relaxed);
+                return memory;
+            }
+            auto const sizeClass = sizeClassOf(size);
+            auto const slotSize = (sizeClass + 1u) * granularity;
+            auto &heap = this->localHeap();
+            std::lock_guard<std::mutex> lock(heap.mutex);
+            if(auto slot = heap.freeLists[sizeClass]; slot != nullptr) {
+                heap.freeLists[sizeClass] = *static_cast<void**>(slot);
+                heap.usedBytes.store(heap.usedBytes.load(std::memory_order_relaxed) + slotSize, std::memory_order_relaxed);
+                return slot;
+            }
+            if(static_cast<std::size_t>(heap.bumpEnd - heap.bumpPointer) < slotSize) {
+                auto const block = static_cast<char*>(this->allocateBlock());
+                ::new(block) BlockHeader{&heap};
+                heap.bumpPointer = block + sizeof(BlockHeader);
+                heap.bumpEnd = block + blockSize;
+            }
+            auto const slot = heap.bumpPointer;
+            heap.bumpPointer += slotSize;
+            heap.usedBytes.store(heap.usedBytes.load(std::memory_order_relaxed) + slotSize, std::memory_order_relaxed);
+            return slot;
+        }
+
+        // `size` has to be the size given when allocating `ptr`
+        void deallocate(void *ptr, std::size_t size) {
+            if(size > maximumSlabSize) {
+                ::operator delete(ptr);
+                oversizedBytes.fetch_sub(size, std::memory_order_relaxed);
+                return;
+            }
+            auto const block = reinterpret_cast<std::uintptr_t>(ptr) & ~(blockSize - 1u);
+            auto &heap = *reinterpret_cast<BlockHeader const*>(block)->heap;
+            auto const sizeClass = sizeClassOf(size);
+            std::lock_guard<std::mutex> lock(heap.mutex);
+            *static_cast<void**>(ptr) = heap.freeLists[sizeClass];
+            heap.freeLists[sizeClass] = ptr;
+            heap.usedBytes.store(heap.usedBytes.load(std::memory_order_relaxed) - (sizeClass + 1u) * granularity, std::memory_order_relaxed);
+        }
+
+        // Bytes obtained from the system, i.e. blocks and allocations
+        // exceeding the slabs
+        std::size_t reservedBytes() const {
+            return blockBytes.load(std::memory_order_relaxed) + oversizedBytes.load(std::memory_order_relaxed);
+        }
+        // Bytes handed out and not deallocated, with sizes rounded up to
+        // their size class. Read without synchronisation and thus only
+        // approximate while the arena is in use.
+        std::size_t usedBytes() const {
+            std::size_t result = oversizedBytes.load(std::memory_order_relaxed);
+            for(std::size_t idx = 0; idx < heapCount; ++idx) {
+                result += heaps[idx].usedBytes.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+    };
+}
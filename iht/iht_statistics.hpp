@@ -0,0 +1,280 @@
+/* MIT License
+ * 
+ * Copyright (c) 2022 Niklas Krafczyk
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace IHT {
+    // A set of event counters which can be incremented concurrently at the
+    // cost of an uncontended atomic increment. Every thread increments the
+    // counters of one of a few stripes, each on its own cache line, which are
+    // only summed up when the counters are read.
+    template<std::size_t CounterCount>
+    class StripedCounters {
+    private:
+        static constexpr std::size_t stripeCount = 16;
+        struct alignas(64) Stripe {
+            std::array<std::atomic<std::uint64_t>, CounterCount> counters{};
+        };
+        std::array<Stripe, stripeCount> stripes{};
+
+        static std::size_t localStripe() {
+            static std::atomic<std::size_t> nextStripe{0};
+            thread_local std::size_t const stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % stripeCount;
+            return stripe;
+        }
+    public:
+        void add(std::size_t counter, std::uint64_t amount = 1) {
+            stripes[localStripe()].counters[counter].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        std::uint64_t sum(std::size_t counter) const {
+            std::uint64_t result = 0;
+            for(auto const &stripe : stripes) {
+                result += stripe.counters[counter].load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+    };
+
+    // Counts lengths in buckets of powers of two: bucket `k` counts the
+    // lengths from 2^k to 2^(k+1) - 1. Buckets are added as needed, so
+    // the last bucket is never empty.
+    class LengthHistogram {
+    private:
+        std::vector<std::size_t> buckets;
+    public:
+        void add(std::size_t length) {
+            std::size_t bucket = 0;
+            while(length > 1u) {
+                length >>= 1u;
+                ++bucket;
+            }
+            if(buckets.size() <= bucket) {
+                buckets.resize(bucket + 1u, 0);
+            }
+            ++buckets[bucket];
+        }
+
+        std::vector<std::size_t> const &getBuckets() const {
+            return buckets;
+        }
+
+        static std::size_t lowerBoundOf(std::size_t bucket) {
+            return std::size_t{1} << bucket;
+        }
+        static std::size_t upperBoundOf(std::size_t bucket) {
+            return (std::size_t{2} << bucket) - 1u;
+        }
+
+        // Prints `1:a 2-3:b 4-7:c ...`
+        void printText(std::ostream &out) const {
+            for(std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+                if(bucket > 0) {
+                    out << ' ';
+                }
+                out << lowerBoundOf(bucket);
+                if(upperBoundOf(bucket) != lowerBoundOf(bucket)) {
+                    out << '-' << upperBoundOf(bucket);
+                }
+                out << ':' << buckets[bucket];
+            }
+        }
+
+        // Prints the counts as an array, indexed by bucket
+        void printJson(std::ostream &out) const {
+            out << '[';
+            for(std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+                if(bucket > 0) {
+                    out << ',';
+                }
+                out << buckets[bucket];
+            }
+            out << ']';
+        }
+    };
+
+    // A snapshot of the state of an `IHTFactory` and of the events counted
+    // since its construction. Counters are read without synchronising with
+    // concurrent operations and thus only add up approximately while the
+    // factory is in use.
+    struct IHTFactoryStatistics {
+        std::size_t shards = 0;
+        // Registered nodes, including nodes about to be unregistered
+        std::size_t liveNodes = 0;
+        // Slots of the node tables and the slots occupied by nodes or by
+        // tombstones of removed nodes
+        std::size_t tableSlots = 0;
+        std::size_t usedSlots = 0;
+        // Number of slots inspected to find a registered node, counting the
+        // slot holding it
+        std::size_t maxProbeLength = 0;
+        double meanProbeLength = 0.0;
+        // Probe lengths of the registered nodes and lengths of the clusters,
+        // the runs of occupied slots a probe for a hash might have to scan
+        // up to its end
+        IHT::LengthHistogram probeLengths;
+        IHT::LengthHistogram clusterLengths;
+        // Released nodes awaiting their unregistration
+        std::size_t pendingDisposals = 0;
+
+        // Lookups of existing nodes, of which `threadCacheHits` have been
+        // answered by the cache of the calling thread
+        std::uint64_t lookupHits = 0;
+        std::uint64_t lookupMisses = 0;
+        std::uint64_t threadCacheHits = 0;
+        std::uint64_t insertions = 0;
+        // Insertions which found an equivalent node inserted concurrently
+        std::uint64_t insertionRacesLost = 0;
+        std::uint64_t unregistrations = 0;
+        // Acquisitions of shard mutexes which had to wait and the total time
+        // spent waiting
+        std::uint64_t contendedLocks = 0;
+        std::uint64_t lockWaitNanoseconds = 0;
+
+        void printText(std::ostream &out) const {
+            out << "shards: " << shards << '\n'
+                << "live nodes: " << liveNodes << '\n'
+                << "table slots: " << tableSlots << '\n'
+                << "used slots: " << usedSlots << '\n'
+                << "max probe length: " << maxProbeLength << '\n'
+                << "mean probe length: " << meanProbeLength << '\n'
+                << "probe lengths: ";
+            probeLengths.printText(out);
+            out << '\n'
+                << "cluster lengths: ";
+            clusterLengths.printText(out);
+            out << '\n'
+                << "pending disposals: " << pendingDisposals << '\n'
+                << "lookup hits: " << lookupHits << '\n'
+                << "lookup misses: " << lookupMisses << '\n'
+                << "thread cache hits: " << threadCacheHits << '\n'
+                << "insertions: " << insertions << '\n'
+                << "insertion races lost: " << insertionRacesLost << '\n'
+                << "unregistrations: " << unregistrations << '\n'
+                << "contended locks: " << contendedLocks << '\n'
+                << "lock wait ns: " << lockWaitNanoseconds << '\n';
+        }
+
+        void printJson(std::ostream &out) const {
+            out << "{\"shards\":" << shards
+                << ",\"liveNodes\":" << liveNodes
+                << ",\"tableSlots\":" << tableSlots
+                << ",\"usedSlots\":" << usedSlots
+                << ",\"maxProbeLength\":" << maxProbeLength
+                << ",\"meanProbeLength\":" << meanProbeLength
+                << ",\"probeLengths\":";
+            probeLengths.printJson(out);
+            out << ",\"clusterLengths\":";
+            clusterLengths.printJson(out);
+            out << ",\"pendingDisposals\":" << pendingDisposals
+                << ",\"lookupHits\":" << lookupHits
+                << ",\"lookupMisses\":" << lookupMisses
+                << ",\"threadCacheHits\":" << threadCacheHits
+                << ",\"insertions\":" << insertions
+                << ",\"insertionRacesLost\":" << insertionRacesLost
+                << ",\"unregistrations\":" << unregistrations
+                << ",\"contendedLocks\":" << contendedLocks
+                << ",\"lockWaitNanoseconds\":" << lockWaitNanoseconds
+                << '}';
+        }
+    };
+
+    inline std::ostream &operator<<(std::ostream &out, IHTFactoryStatistics const &statistics) {
+        statistics.printText(out);
+        return out;
+    }
+
+    // The memory used by an `IHTFactory`. All figures are maintained while
+    // nodes are registered and unregistered, so a report is produced without
+    // inspecting the nodes. Like the statistics, they only add up
+    // approximately while the factory is in use.
+    struct IHTFactoryMemoryReport {
+        struct NodeClassUsage {
+            std::size_t nodes = 0;
+            std::size_t bytes = 0;
+        };
+
+        // Registered nodes, including nodes about to be unregistered
+        std::size_t liveNodes = 0;
+        // Bytes the arena obtained from the system and the bytes of the
+        // slots it handed out, which include the reserve for control blocks
+        // of shared pointers
+        std::size_t arenaReservedBytes = 0;
+        std::size_t arenaUsedBytes = 0;
+        std::size_t controlBlockBytes = 0;
+        // Slot arrays of the node tables and the entries they point to
+        std::size_t tableBytes = 0;
+        std::size_t entryBytes = 0;
+        // Ids of unregistered nodes kept for reuse
+        std::size_t freeNodeIdBytes = 0;
+        // Registered nodes and the bytes they occupy as reported by the node
+        // type, indexed by the class of the node. Nodes with a custom deleter
+        // are not allocated in the arena.
+        std::vector<NodeClassUsage> nodeClasses;
+
+        std::size_t totalBytes() const {
+            return arenaReservedBytes + tableBytes + entryBytes + freeNodeIdBytes;
+        }
+
+        void printText(std::ostream &out) const {
+            out << "live nodes: " << liveNodes << '\n'
+                << "arena reserved bytes: " << arenaReservedBytes << '\n'
+                << "arena used bytes: " << arenaUsedBytes << '\n'
+                << "control block bytes: " << controlBlockBytes << '\n'
+                << "table bytes: " << tableBytes << '\n'
+                << "entry bytes: " << entryBytes << '\n'
+                << "free node id bytes: " << freeNodeIdBytes << '\n'
+                << "total bytes: " << this->totalBytes() << '\n';
+            for(std::size_t idx = 0; idx < nodeClasses.size(); ++idx) {
+                out << "node class " << idx << ": " << nodeClasses[idx].nodes << " nodes, " << nodeClasses[idx].bytes << " bytes\n";
+            }
+        }
+
+        void printJson(std::ostream &out) const {
+            out << "{\"liveNodes\":" << liveNodes
+                << ",\"arenaReservedBytes\":" << arenaReservedBytes
+                << ",\"arenaUsedBytes\":" << arenaUsedBytes
+                << ",\"controlBlockBytes\":" << controlBlockBytes
+                << ",\"tableBytes\":" << tableBytes
+                << ",\"entryBytes\":" << entryBytes
+                << ",\"freeNodeIdBytes\":" << freeNodeIdBytes
+                << ",\"totalBytes\":" << this->totalBytes()
+                << ",\"nodeClasses\":[";
+            for(std::size_t idx = 0; idx < nodeClasses.size(); ++idx) {
+                out << (idx > 0 ? "," : "") << "{\"nodes\":" << nodeClasses[idx].nodes << ",\"bytes\":" << nodeClasses[idx].bytes << '}';
+            }
+            out << "]}";
+        }
+    };
+
+    inline std::ostream &operator<<(std::ostream &out, IHTFactoryMemoryReport const &report) {
+        report.printText(out);
+        return out;
+    }
+}
@@ -22,8 +22,37 @@
  */
 
 #include "libexpressions/matchers/hierarchyMatchers.hpp"
+#include "libexpressions/expressions/expression_visit_helper.hpp"
+
+#include <unordered_set>
 
 namespace libexpressions::Matchers {
+    namespace {
+        // Breadth first search for a match among the distinct subexpressions
+        // of `expression`, which is only included if `includeExpression` is
+        // true
+        bool anyDistinctSubexpressionMatches(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression,
+                                             libexpressions::MatcherImpl const &matcher, bool includeExpression) {
+            std::deque<libexpressions::ExprRef> worklist;
+            std::unordered_set<std::uint32_t> seen;
+            worklist.push_back(expression);
+            seen.insert(expression.getIndex());
+            while(!worklist.empty()) {
+                auto const current = worklist.front();
+                worklist.pop_front();
+                if((includeExpression or current != expression) and matcher(store, current)) {
+                    return true;
+                }
+                for(auto const child : store.getOperands(current)) {
+                    if(seen.insert(child.getIndex()).second) {
+                        worklist.push_back(child);
+                    }
+                }
+            }
+            return false;
+        }
+    }
+
     /// EqualityProperty
     std::unique_ptr<MatcherImpl> EqualityProperty::construct() const {
         return std::unique_ptr<MatcherImpl>(new EqualityProperty(ref));
@@ -33,47 +62,79 @@ namespace libexpressions::Matchers {
         bool result = ptr->equal_to(this->ref.get());
         return result;
     }
+    bool EqualityProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return store.equals(expression, this->ref.get());
+    }
+    bool EqualityProperty::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        // A subexpression is never deeper or larger than the expression
+        // containing it and contains a subset of its atoms
+        return ptr->getDepth() >= ref->getDepth()
+            and ptr->getTreeSize() >= ref->getTreeSize()
+            and ptr->getSymbolSignature().mayContain(ref->getSymbolSignature());
+    }
 
     /// HasChildProperty
     std::unique_ptr<MatcherImpl> HasChildProperty::construct() const {
         return std::unique_ptr<MatcherImpl>(new HasChildProperty);
     }
     bool HasChildProperty::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
-        if(dynamic_cast<libexpressions::Operator const*>(ptr.get()) != nullptr) {
-            libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(ptr.get());
+        if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(ptr.get()); op != nullptr) {
             return std::any_of(op->begin(), op->end(), [this](libexpressions::ExpressionNodePtr const &child)->bool {
                         return this->nested->operator()(child);
             });
         }
         return false;
     }
+    bool HasChildProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        auto const operands = store.getOperands(expression);
+        return std::any_of(operands.begin(), operands.end(), [this,&store](libexpressions::ExprRef child) {
+            return this->nested->operator()(store, child);
+        });
+    }
+    bool HasChildProperty::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return this->nested->mayMatchWithin(ptr);
+    }
     /// AllChildrenProperty
     std::unique_ptr<MatcherImpl> AllChildrenProperty::construct() const {
         return std::unique_ptr<MatcherImpl>(new AllChildrenProperty);
     }
     bool AllChildrenProperty::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
-        if(dynamic_cast<libexpressions::Operator const*>(ptr.get()) != nullptr) {
-            libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(ptr.get());
+        if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(ptr.get()); op != nullptr) {
             return std::all_of(op->begin(), op->end(), [this](libexpressions::ExpressionNodePtr const &child)->bool {
                         return this->nested->operator()(child);
             });
         }
         return false;
     }
+    bool AllChildrenProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        if(store.getKind(expression) != libexpressions::ExpressionNodeKind::EXPRESSION_OPERATOR) {
+            return false;
+        }
+        auto const operands = store.getOperands(expression);
+        return std::all_of(operands.begin(), operands.end(), [this,&store](libexpressions::ExprRef child) {
+            return this->nested->operator()(store, child);
+        });
+    }
     /// NthChildProperty
     std::unique_ptr<MatcherImpl> NthChildProperty::construct() const {
         return std::unique_ptr<MatcherImpl>(new NthChildProperty(n));
     }
     NthChildProperty::NthChildProperty(size_t param) : n(param) {}
     bool NthChildProperty::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
-        if(dynamic_cast<libexpressions::Operator const*>(ptr.get()) != nullptr) {
-            libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(ptr.get());
+        if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(ptr.get()); op != nullptr) {
             auto iter = op->begin();
             std::advance(iter, static_cast<ssize_t>(n));
             return this->nested->operator()(*iter);
         }
         return false;
     }
+    bool NthChildProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        auto const operands = store.getOperands(expression);
+        return n < operands.size() and this->nested->operator()(store, operands[n]);
+    }
+    bool NthChildProperty::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return this->nested->mayMatchWithin(ptr);
+    }
     /// AllExceptNthChildProperty
     std::unique_ptr<MatcherImpl> AllExceptNthChildProperty::construct() const {
         return std::unique_ptr<MatcherImpl>(new AllExceptNthChildProperty(n));
@@ -81,8 +142,7 @@ namespace libexpressions::Matchers {
     AllExceptNthChildProperty::AllExceptNthChildProperty(size_t param) : n(param) {}
 
     bool AllExceptNthChildProperty::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
-        if(dynamic_cast<libexpressions::Operator const*>(ptr.get()) != nullptr) {
-            libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(ptr.get());
+        if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(ptr.get()); op != nullptr) {
             size_t idx = 0;
             for(auto iter = op->begin(); iter != op->end(); ++iter, ++idx) {
                 if(idx != n and not this->nested->operator()(*iter)) {
@@ -93,6 +153,18 @@ namespace libexpressions::Matchers {
         }
         return false;
     }
+    bool AllExceptNthChildProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        if(store.getKind(expression) != libexpressions::ExpressionNodeKind::EXPRESSION_OPERATOR) {
+            return false;
+        }
+        auto const operands = store.getOperands(expression);
+        for(size_t idx = 0; idx < operands.size(); ++idx) {
+            if(idx != n and not this->nested->operator()(store, operands[idx])) {
+                return false;
+            }
+        }
+        return true;
+    }
 
     /// KleeneProperty
     std::unique_ptr<MatcherImpl> KleeneProperty::construct() const {
@@ -103,17 +175,25 @@ namespace libexpressions::Matchers {
         worklist.push_back(ptr);
         while(!worklist.empty()) {
             libexpressions::ExpressionNodePtr node = worklist.front();
+            worklist.pop_front();
+            if(not this->nested->mayMatchWithin(node)) {
+                continue;
+            }
             if(this->nested->operator()(node)) {
                 return true;
             }
-            if(dynamic_cast<libexpressions::Operator const*>(node.get()) != nullptr) {
-                libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(node.get());
+            if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(node.get()); op != nullptr) {
                 worklist.insert(worklist.end(), op->begin(), op->end());
             }
-            worklist.pop_front();
         }
         return false;
     }
+    bool KleeneProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return anyDistinctSubexpressionMatches(store, expression, *this->nested, true);
+    }
+    bool KleeneProperty::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return this->nested->mayMatchWithin(ptr);
+    }
     
     /// AllChildrenRecurseProperty
     std::unique_ptr<MatcherImpl> AllChildrenRecurseProperty::construct() const {
@@ -123,7 +203,7 @@ namespace libexpressions::Matchers {
     bool AllChildrenRecurseProperty::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
         if(this->nested->operator()(ptr)) {
             return true;
-        } else if(auto op = dynamic_cast<libexpressions::Operator const*>(ptr.get());
+        } else if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(ptr.get());
           op != nullptr ) {
             if (this->invariantMatcher->operator()(ptr)) {
                 for (auto const &child: *op) {
@@ -136,6 +216,20 @@ namespace libexpressions::Matchers {
         }
         return false;
     }
+    bool AllChildrenRecurseProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        if(this->nested->operator()(store, expression)) {
+            return true;
+        } else if(store.getKind(expression) == libexpressions::ExpressionNodeKind::EXPRESSION_OPERATOR
+                  and this->invariantMatcher->operator()(store, expression)) {
+            for(auto const child : store.getOperands(expression)) {
+                if(not this->operator()(store, child)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
 
     /// DescendantProperty
     std::unique_ptr<MatcherImpl> DescendantProperty::construct() const {
@@ -146,17 +240,25 @@ namespace libexpressions::Matchers {
         worklist.push_back(ptr);
         while(!worklist.empty()) {
             libexpressions::ExpressionNodePtr node = worklist.front();
+            worklist.pop_front();
+            if(not this->nested->mayMatchWithin(node)) {
+                continue;
+            }
             if(node != ptr && this->nested->operator()(node)) {
                 return true;
             }
-            if(dynamic_cast<libexpressions::Operator const*>(node.get()) != nullptr) {
-                libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(node.get());
+            if(auto op = libexpressions::dyn_cast<libexpressions::Operator>(node.get()); op != nullptr) {
                 worklist.insert(worklist.end(), op->begin(), op->end());
             }
-            worklist.pop_front();
         }
         return false;
     }
+    bool DescendantProperty::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return anyDistinctSubexpressionMatches(store, expression, *this->nested, false);
+    }
+    bool DescendantProperty::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return this->nested->mayMatchWithin(ptr);
+    }
 
     Matcher IsEqual(libexpressions::ExpressionNodePtr const &ptr) {
         EqualityProperty x(ptr);
@@ -35,18 +35,23 @@ namespace libexpressions::Matchers {
     public:
         EqualityProperty(libexpressions::ExpressionNodePtr const &ptr);
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
     };
     class HasChildProperty : public MatcherImpl {
     protected:
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
     };
     class AllChildrenProperty : public MatcherImpl {
     protected:
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
     };
     class NthChildProperty : public MatcherImpl {
     private:
@@ -56,6 +61,8 @@ namespace libexpressions::Matchers {
     public:
         NthChildProperty(size_t param);
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
     };
     class AllExceptNthChildProperty : public MatcherImpl {
     private:
@@ -66,6 +73,8 @@ namespace libexpressions::Matchers {
         AllExceptNthChildProperty(size_t param);
 
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
     };
 
     class KleeneProperty : public MatcherImpl {
@@ -73,6 +82,8 @@ namespace libexpressions::Matchers {
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
     };
     class AllChildrenRecurseProperty : public MatcherImpl {
     private:
@@ -82,12 +93,15 @@ namespace libexpressions::Matchers {
     public:
         AllChildrenRecurseProperty(std::unique_ptr<MatcherImpl> &&invariant);
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
     };
     class DescendantProperty : public MatcherImpl {
     protected:
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
     };
 
     Matcher IsEqual(libexpressions::ExpressionNodePtr const &ptr);
@@ -59,6 +59,16 @@ namespace libexpressions::Matchers {
         }
         return true;
     }
+    bool MatcherConjunction::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return std::all_of(matchers.begin(), matchers.end(), [&store,expression](auto const &matcher) {
+            return matcher->operator()(store, expression);
+        });
+    }
+    bool MatcherConjunction::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return std::all_of(matchers.begin(), matchers.end(), [&ptr](auto const &matcher) {
+            return matcher->mayMatchWithin(ptr);
+        });
+    }
 
     /// MatcherDisjunction
     std::unique_ptr<MatcherImpl> MatcherDisjunction::construct() const {
@@ -72,6 +82,16 @@ namespace libexpressions::Matchers {
         }
         return false;
     }
+    bool MatcherDisjunction::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return std::any_of(matchers.begin(), matchers.end(), [&store,expression](auto const &matcher) {
+            return matcher->operator()(store, expression);
+        });
+    }
+    bool MatcherDisjunction::mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const {
+        return std::any_of(matchers.begin(), matchers.end(), [&ptr](auto const &matcher) {
+            return matcher->mayMatchWithin(ptr);
+        });
+    }
 
     /// MatcherNegation
     std::unique_ptr<MatcherImpl> MatcherNegation::construct() const {
@@ -80,5 +100,8 @@ namespace libexpressions::Matchers {
     bool MatcherNegation::operator()(libexpressions::ExpressionNodePtr const &ptr) const {
         return nested->operator()(ptr) == false;
     }
+    bool MatcherNegation::operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const {
+        return nested->operator()(store, expression) == false;
+    }
 }
 
@@ -52,7 +52,7 @@ namespace libexpressions::Matchers {
         template<typename T, std::enable_if_t<std::is_same_v<std::vector<std::unique_ptr<libexpressions::MatcherImpl>>, std::decay_t<T>>, bool> = true>
         std::unique_ptr<libexpressions::MatcherImpl> operator()(T &&matchersToUse) {
             auto obj = this->construct();
-            auto multimatcher = dynamic_cast<MultiMatcher*>(obj.get());
+            auto multimatcher = static_cast<MultiMatcher*>(obj.get());
             for(auto const &matcher : matchersToUse) {
                 multimatcher->matchers.emplace_back(matcher->clone());
             }
@@ -61,7 +61,7 @@ namespace libexpressions::Matchers {
         template<typename T, std::enable_if_t<std::is_same_v<std::vector<Matcher>, std::decay_t<T>>, bool> = true>
         std::unique_ptr<libexpressions::MatcherImpl> operator()(T &&matchersToUse) {
             auto obj = this->construct();
-            auto multimatcher = dynamic_cast<MultiMatcher*>(obj.get());
+            auto multimatcher = static_cast<MultiMatcher*>(obj.get());
             for(auto const &matcher : matchersToUse) {
                 multimatcher->matchers.emplace_back(matcher.getImpl()->clone());
             }
@@ -70,7 +70,7 @@ namespace libexpressions::Matchers {
         template<typename ...Args>
         std::unique_ptr<libexpressions::MatcherImpl> operator()(Args&&... matcherArgs) const {
             auto obj = this->construct();
-            auto matcher = dynamic_cast<MultiMatcher*>(obj.get());
+            auto matcher = static_cast<MultiMatcher*>(obj.get());
             this->addMatcher(matcher, matcherArgs...);
             return obj;
         }
@@ -82,6 +82,8 @@ namespace libexpressions::Matchers {
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
 
         using MultiMatcher::operator();
     };
@@ -90,6 +92,8 @@ namespace libexpressions::Matchers {
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
+        bool mayMatchWithin(libexpressions::ExpressionNodePtr const &ptr) const override;
 
         using MultiMatcher::operator();
     };
@@ -98,6 +102,7 @@ namespace libexpressions::Matchers {
         std::unique_ptr<MatcherImpl> construct() const override;
     public:
         bool operator()(libexpressions::ExpressionNodePtr const &ptr) const override;
+        bool operator()(libexpressions::ExpressionStore const &store, libexpressions::ExprRef expression) const override;
 
         using MatcherImpl::operator();
     };
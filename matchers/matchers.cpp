@@ -36,6 +36,14 @@ namespace libexpressions {
         return this->operator()(matcher.getImpl()->clone());
     }
 
+    bool MatcherImpl::operator()(ExpressionStore const &store, ExprRef expression) const {
+        return this->operator()(store.materialize(expression, *ExpressionFactory::get()));
+    }
+
+    bool MatcherImpl::mayMatchWithin(ExpressionNodePtr const &) const {
+        return true;
+    }
+
     std::unique_ptr<MatcherImpl> MatcherImpl::clone() const {
         if(nested != nullptr) {
             return this->construct(nested->clone());
@@ -50,9 +58,15 @@ namespace libexpressions {
     bool Matcher::operator()(ExpressionNodePtr const &ptr) const {
         return matcher->operator()(ptr);
     }
+    bool Matcher::operator()(ExpressionStore const &store, ExprRef expression) const {
+        return matcher->operator()(store, expression);
+    }
     Matcher Matcher::operator()(Matcher const &other) const {
         return { matcher->operator()(other.matcher->clone()) };
     }
+    bool Matcher::mayMatchWithin(ExpressionNodePtr const &ptr) const {
+        return matcher->mayMatchWithin(ptr);
+    }
 
     std::unique_ptr<MatcherImpl> const &Matcher::getImpl() const {
         return this->matcher;
@@ -29,9 +29,11 @@
 #include <type_traits>
 #include <cassert>
 #include <tuple>
+#include <unordered_set>
 
 #include "libexpressions/expressions/expression_node.hpp"
 #include "libexpressions/expressions/operator.hpp"
+#include "libexpressions/expressions/expression_store.hpp"
 #include "libexpressions/utils/expression-tree-visit.hpp"
 
 namespace libexpressions {
@@ -47,6 +49,14 @@ namespace libexpressions {
         virtual std::unique_ptr<MatcherImpl> operator()(Matcher const &matcher) const final;
 
         virtual bool operator()(ExpressionNodePtr const &ptr) const = 0;
+        // Matches an expression held by an ExpressionStore. The matchers of
+        // the library inspect the store directly. By default, the
+        // expression is converted to nodes of ExpressionFactory::get().
+        virtual bool operator()(ExpressionStore const &store, ExprRef expression) const;
+        // Returns false only if no node of the expression `ptr`, including
+        // `ptr` itself, can be matched. Used to skip whole subexpressions
+        // based on the metadata cached in each node.
+        virtual bool mayMatchWithin(ExpressionNodePtr const &ptr) const;
 
         virtual std::unique_ptr<MatcherImpl> clone() const;
     };
@@ -58,7 +68,9 @@ namespace libexpressions {
         Matcher(Matcher const &other);
 
         bool operator()(ExpressionNodePtr const &ptr) const;
+        bool operator()(ExpressionStore const &store, ExprRef expression) const;
         Matcher operator()(Matcher const &other) const;
+        bool mayMatchWithin(ExpressionNodePtr const &ptr) const;
 
         std::unique_ptr<MatcherImpl> const &getImpl() const;
     };
@@ -100,5 +112,38 @@ namespace libexpressions {
             return true;
         });
     }
+
+    // Invoke function `fn` on the handles of all subexpressions of an
+    // expression held by an ExpressionStore where a given matcher matches,
+    // without converting the expression to nodes. Every distinct
+    // subexpression is visited once, with the path of its first occurrence
+    // in the traversal, so shared subexpressions do not multiply the work.
+    // Like above, `fn` may stop the traversal by returning false.
+    template<TreeTraversalOrder direction, typename Fn>
+    void invokeUsingMatcher(ExprRef expression, ExpressionStore const &store, Matcher m, Fn &&fn) {
+        std::unordered_set<std::uint32_t> expanded;
+        std::unordered_set<std::uint32_t> visited;
+        auto functionToCall = [&m,&fn,&store,&visited](ExprRef const &ref, Operator::Path const &path) -> bool {
+            if(not visited.insert(ref.getIndex()).second or not m(store, ref)) {
+                return true;
+            }
+            if constexpr(std::is_same_v<std::decay_t<std::invoke_result_t<Fn, ExprRef const, Operator::Path const>>, bool>) {
+                return fn(ref, path);
+            } else {
+                fn(ref, path);
+                return true;
+            }
+        };
+        // Subexpressions seen before are not descended into again
+        traverseTree<direction>([&store,&expanded](ExprRef const &ref) {
+                                    auto const [first, last] = store.getChildrenIterators(ref);
+                                    if(not expanded.insert(ref.getIndex()).second) {
+                                        return std::make_tuple(last, last);
+                                    }
+                                    return std::make_tuple(first, last);
+                                },
+                                functionToCall,
+                                expression);
+    }
 }
 
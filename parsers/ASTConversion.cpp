@@ -26,6 +26,7 @@
 #include "libexpressions/expressions/expression_factory.hpp"
 #include "libexpressions/expressions/operator.hpp"
 #include "libexpressions/expressions/atom.hpp"
+#include "libexpressions/expressions/literal.hpp"
 #include "libexpressions/parsers/ast.hpp"
 #include "libexpressions/parsers/ExpressionRepresentationInterface.hpp"
 #include <cassert>
@@ -51,12 +52,14 @@ generateExpressionListFromAST(libexpressions::ExpressionFactory *factory, libexp
     std::stack<Operand<std::string>> stOperands;
     std::stack<Operator<std::string>> stOperators;
     std::stack<AtomicProposition<std::string>> stAtoms;
+    std::stack<NumericLiteral> stLiterals;
     std::stack<std::stack<libexpressions::ExpressionNodePtr>> buildingStack;
     enum State_t {
         EXPRESSIONLIST,
         OPERAND,
         OPERATOR,
-        ATOM
+        ATOM,
+        LITERAL
     };
     std::stack<State_t> state;
     state.push(EXPRESSIONLIST);
@@ -64,13 +67,16 @@ generateExpressionListFromAST(libexpressions::ExpressionFactory *factory, libexp
     private:
         std::stack<decltype(stOperators)::value_type> &operatorStack;
         std::stack<decltype(stAtoms)::value_type> &apStack;
+        std::stack<decltype(stLiterals)::value_type> &literalStack;
         std::stack<decltype(state)::value_type> &stateStack;
     public:
         OperandVisitor(std::stack<Operator<std::string>> &opStack,
                        std::stack<AtomicProposition<std::string>> &paramApStack,
+                       std::stack<NumericLiteral> &paramLiteralStack,
                        std::stack<State_t> &stStack) :
                        operatorStack(opStack),
                        apStack(paramApStack),
+                       literalStack(paramLiteralStack),
                        stateStack(stStack) {}
         void operator()(AtomicProposition<std::string> const &ap) {
             apStack.push(ap);
@@ -80,7 +86,11 @@ generateExpressionListFromAST(libexpressions::ExpressionFactory *factory, libexp
             operatorStack.push(op);
             stateStack.push(OPERATOR);
         }
-    } operandVisitor(stOperators, stAtoms, state);
+        void operator()(NumericLiteral const &literal) {
+            literalStack.push(literal);
+            stateStack.push(LITERAL);
+        }
+    } operandVisitor(stOperators, stAtoms, stLiterals, state);
     do {
         if(state.top() == EXPRESSIONLIST) {
             if(buildingStack.size() > 0) {
@@ -129,6 +139,10 @@ generateExpressionListFromAST(libexpressions::ExpressionFactory *factory, libexp
             buildingStack.top().push(factory->makeIdentifier(std::move(stAtoms.top())));
             stAtoms.pop();
             state.pop(); //Pop ATOM
+        } else if(state.top() == LITERAL) {
+            buildingStack.top().push(factory->makeLiteral(stLiterals.top()));
+            stLiterals.pop();
+            state.pop(); //Pop LITERAL
         }
     } while(!state.empty());
     std::vector<libexpressions::ExpressionNodePtr> result;
@@ -151,7 +165,8 @@ ExpressionList<std::string>   generateASTFromExpressions(std::vector<libexpressi
         OPERAND_UP,
         OPERATOR_DOWN,
         OPERATOR_UP,
-        ATOM
+        ATOM,
+        LITERAL
     };
     std::stack<State_t> state;
     state.push(EXPRESSION_DOWN);
@@ -168,6 +183,15 @@ ExpressionList<std::string>   generateASTFromExpressions(std::vector<libexpressi
         void operator()(libexpressions::Operator const */*op*/) {
             stateStack.push(OPERATOR_DOWN);
         }
+        void operator()(libexpressions::IntegerLiteral const */*literal*/) {
+            stateStack.push(LITERAL);
+        }
+        void operator()(libexpressions::RealLiteral const */*literal*/) {
+            stateStack.push(LITERAL);
+        }
+        void operator()(libexpressions::BigIntegerLiteral const */*literal*/) {
+            stateStack.push(LITERAL);
+        }
     } operandVisitor(state);
     do {
         if(state.top() == EXPRESSION_DOWN) {
@@ -192,8 +216,8 @@ ExpressionList<std::string>   generateASTFromExpressions(std::vector<libexpressi
             state.pop();
             state.push(OPERATOR_UP);
 
-            assert(dynamic_cast<libexpressions::Operator const*>(decompositionStack.top().get()) != nullptr);
-            libexpressions::Operator const &op = *std::static_pointer_cast<libexpressions::Operator const>(decompositionStack.top());
+            assert(libexpressions::Operator::classof(decompositionStack.top().get()));
+            libexpressions::Operator const &op = *IHT::static_pointer_cast<libexpressions::Operator const>(decompositionStack.top());
 
             for(auto const &operand : op) {
                 state.push(OPERAND_DOWN);
@@ -214,8 +238,8 @@ ExpressionList<std::string>   generateASTFromExpressions(std::vector<libexpressi
                 stOperators.pop();
             }
         } else if(state.top() == ATOM) {
-            assert(dynamic_cast<libexpressions::Atom const*>(decompositionStack.top().get()) != nullptr);
-            libexpressions::Atom const &atom = *std::static_pointer_cast<libexpressions::Atom const>(decompositionStack.top());
+            assert(libexpressions::Atom::classof(decompositionStack.top().get()));
+            libexpressions::Atom const &atom = *IHT::static_pointer_cast<libexpressions::Atom const>(decompositionStack.top());
 
             stAtoms.push(AtomicProposition<std::string>(atom.getSymbol()));
             decompositionStack.pop();
@@ -224,6 +248,15 @@ ExpressionList<std::string>   generateASTFromExpressions(std::vector<libexpressi
                 stOperands.top().emplace(std::move(stAtoms.top()));
                 stAtoms.pop();
             }
+        } else if(state.top() == LITERAL) {
+            auto literal = libexpressions::getNumericValue(decompositionStack.top().get());
+            assert(literal.has_value());
+
+            decompositionStack.pop();
+            state.pop();
+            if(state.top() == OPERAND_UP) {
+                stOperands.top().emplace(std::move(literal.value()));
+            }
         }
     } while(!state.empty());
     return stackToVector(std::move(stOperands.top()));
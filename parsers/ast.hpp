@@ -26,11 +26,16 @@
 #include <vector>
 #include <variant>
 
+#include "libexpressions/expressions/numeric_value.hpp"
+
 namespace libexpressions::parsers {
 
 template<typename T>
 using AtomicProposition = T;
 
+// Numeric literals are recognised by the parser and kept as values
+using NumericLiteral = libexpressions::NumericValue;
+
 template<typename T>
 struct Operator_t;
 
@@ -38,7 +43,7 @@ template<typename T>
 using Operator = struct Operator_t<T>;
 
 template<typename T>
-using Operand = std::variant<AtomicProposition<T>, Operator<T>>;
+using Operand = std::variant<AtomicProposition<T>, Operator<T>, NumericLiteral>;
 
 template<typename T>
 struct Operator_t {
@@ -48,6 +48,9 @@ std::string sExpressionToString(libexpressions::parsers::Expression<std::string>
         std::tuple<Iterator, Iterator> operator()(AtomicProposition<std::string> const &/*at*/) const {
             return { Iterator(), Iterator() };
         }
+        std::tuple<Iterator, Iterator> operator()(NumericLiteral const &/*literal*/) const {
+            return { Iterator(), Iterator() };
+        }
         std::tuple<Iterator, Iterator> operator()(Operand<std::string> const &op) const {
             return std::visit(*this, op);
         }
@@ -77,6 +80,9 @@ std::string sExpressionToString(libexpressions::parsers::Expression<std::string>
             void operator()(AtomicProposition<std::string> const &atom) const {
                 resultStack.push_back(atom);
             }
+            void operator()(NumericLiteral const &literal) const {
+                resultStack.push_back(numericValueToString(literal));
+            }
         } printerObj(resultStack);
         return std::visit(printerObj, node);
     };
@@ -1018,7 +1018,7 @@ do_action:	/* This label is used only to access EOF actions. */
 case 1:
 YY_RULE_SETUP
 #line 58 "s-expression-parser.l"
-{ yylval->atom = new libexpressions::parsers::AtomicProposition<std::string>(std::string(yytext, yyleng)); return IDENTIFIER; }
+{ if(auto literal = libexpressions::parseNumericLiteral(std::string_view(yytext, yyleng)); literal.has_value()) { yylval->literal = new libexpressions::parsers::NumericLiteral(std::move(literal.value())); return LITERAL; } yylval->atom = new libexpressions::parsers::AtomicProposition<std::string>(std::string(yytext, yyleng)); return IDENTIFIER; }
 	YY_BREAK
 case 2:
 /* rule 2 can match eol */
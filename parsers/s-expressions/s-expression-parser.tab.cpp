@@ -118,14 +118,15 @@ enum yysymbol_kind_t
   YYSYMBOL_YYerror = 1,                    /* error  */
   YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
   YYSYMBOL_IDENTIFIER = 3,                 /* IDENTIFIER  */
-  YYSYMBOL_WHITESPACE = 4,                 /* WHITESPACE  */
-  YYSYMBOL_5_ = 5,                         /* '('  */
-  YYSYMBOL_6_ = 6,                         /* ')'  */
-  YYSYMBOL_YYACCEPT = 7,                   /* $accept  */
-  YYSYMBOL_OPERAND = 8,                    /* OPERAND  */
-  YYSYMBOL_OPERANDLIST = 9,                /* OPERANDLIST  */
-  YYSYMBOL_OPERATOR = 10,                  /* OPERATOR  */
-  YYSYMBOL_RESULT = 11                     /* RESULT  */
+  YYSYMBOL_LITERAL = 4,                    /* LITERAL  */
+  YYSYMBOL_WHITESPACE = 5,                 /* WHITESPACE  */
+  YYSYMBOL_6_ = 6,                         /* '('  */
+  YYSYMBOL_7_ = 7,                         /* ')'  */
+  YYSYMBOL_YYACCEPT = 8,                   /* $accept  */
+  YYSYMBOL_OPERAND = 9,                    /* OPERAND  */
+  YYSYMBOL_OPERANDLIST = 10,               /* OPERANDLIST  */
+  YYSYMBOL_OPERATOR = 11,                  /* OPERATOR  */
+  YYSYMBOL_RESULT = 12                     /* RESULT  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
@@ -428,21 +429,21 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  7
+#define YYFINAL  8
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   7
+#define YYLAST   9
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  7
+#define YYNTOKENS  8
 /* YYNNTS -- Number of nonterminals.  */
 #define YYNNTS  5
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  7
+#define YYNRULES  8
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  10
+#define YYNSTATES  11
 
 /* YYMAXUTOK -- Last valid token kind.  */
-#define YYMAXUTOK   259
+#define YYMAXUTOK   260
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
@@ -460,7 +461,7 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       5,     6,     2,     2,     2,     2,     2,     2,     2,     2,
+       6,     7,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -481,14 +482,15 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     1,     2,     3,     4
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5
 };
 
 #if LIBEXPRESSIONS_S_EXPRESSIONDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int8 yyrline[] =
 {
-       0,    68,    68,    69,    70,    71,    72,    73
+       0,    70,    70,    71,    72,    73,    74,    75,    76
 };
 #endif
 
@@ -505,8 +507,9 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 {
   static const char *const yy_sname[] =
   {
-  "end of file", "error", "invalid token", "IDENTIFIER", "WHITESPACE",
-  "'('", "')'", "$accept", "OPERAND", "OPERANDLIST", "OPERATOR", "RESULT", YY_NULLPTR
+  "end of file", "error", "invalid token", "IDENTIFIER", "LITERAL",
+  "WHITESPACE", "'('", "')'", "$accept", "OPERAND", "OPERANDLIST",
+  "OPERATOR", "RESULT", YY_NULLPTR
   };
   return yy_sname[yysymbol];
 }
@@ -526,7 +529,8 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-      -4,     1,     5,    -4,    -4,    -4,    -4,    -4,    -3,    -4
+      -4,     2,     7,    -4,    -4,    -4,    -4,    -4,    -4,    -3,
+      -4
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -534,19 +538,20 @@ static const yytype_int8 yypact[] =
    means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
-       5,     7,     0,     2,     5,     4,     3,     1,     0,     6
+       6,     8,     0,     2,     3,     6,     5,     4,     1,     0,
+       7
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-      -4,    -4,     3,    -4,    -4
+      -4,    -4,     4,    -4,    -4
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     5,     1,     6,     2
+       0,     6,     1,     7,     2
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -554,31 +559,32 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-       3,     0,     4,     9,     3,     7,     4,     8
+       3,     4,     0,     5,    10,     3,     4,     8,     5,     9
 };
 
 static const yytype_int8 yycheck[] =
 {
-       3,    -1,     5,     6,     3,     0,     5,     4
+       3,     4,    -1,     6,     7,     3,     4,     0,     6,     5
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,     9,    11,     3,     5,     8,    10,     0,     9,     6
+       0,    10,    12,     3,     4,     6,     9,    11,     0,    10,
+       7
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,     7,     8,     8,     9,     9,    10,    11
+       0,     8,     9,     9,     9,    10,    10,    11,    12
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
-       0,     2,     1,     1,     2,     0,     3,     1
+       0,     2,     1,     1,     1,     2,     0,     3,     1
 };
 
 
@@ -1535,43 +1541,49 @@ yyreduce:
     switch (yyn)
       {
   case 2: /* OPERAND: IDENTIFIER  */
-#line 68 "s-expression-parser.y"
+#line 70 "s-expression-parser.y"
                     { (yyval.operand) = new libexpressions::parsers::Operand<std::string>(*(yyvsp[0].atom)); delete (yyvsp[0].atom); }
-#line 1541 "s-expression-parser.tab.cpp"
+#line 1547 "s-expression-parser.tab.cpp"
+    break;
+
+  case 3: /* OPERAND: LITERAL  */
+#line 71 "s-expression-parser.y"
+                                   { (yyval.operand) = new libexpressions::parsers::Operand<std::string>(std::move(*(yyvsp[0].literal))); delete (yyvsp[0].literal); }
+#line 1553 "s-expression-parser.tab.cpp"
     break;
 
-  case 3: /* OPERAND: OPERATOR  */
-#line 69 "s-expression-parser.y"
+  case 4: /* OPERAND: OPERATOR  */
+#line 72 "s-expression-parser.y"
                                     { (yyval.operand) = new libexpressions::parsers::Operand<std::string>(*(yyvsp[0].oprtr)); delete (yyvsp[0].oprtr); }
-#line 1547 "s-expression-parser.tab.cpp"
+#line 1559 "s-expression-parser.tab.cpp"
     break;
 
-  case 4: /* OPERANDLIST: OPERANDLIST OPERAND  */
-#line 70 "s-expression-parser.y"
+  case 5: /* OPERANDLIST: OPERANDLIST OPERAND  */
+#line 73 "s-expression-parser.y"
                                                { (yyval.operandList) = (yyvsp[-1].operandList); (yyval.operandList)->push_back(std::move(*(yyvsp[0].operand))); delete (yyvsp[0].operand); }
-#line 1553 "s-expression-parser.tab.cpp"
+#line 1565 "s-expression-parser.tab.cpp"
     break;
 
-  case 5: /* OPERANDLIST: %empty  */
-#line 71 "s-expression-parser.y"
+  case 6: /* OPERANDLIST: %empty  */
+#line 74 "s-expression-parser.y"
                                                                                   { (yyval.operandList) = new std::vector<libexpressions::parsers::Operand<std::string>>(); }
-#line 1559 "s-expression-parser.tab.cpp"
+#line 1571 "s-expression-parser.tab.cpp"
     break;
 
-  case 6: /* OPERATOR: '(' OPERANDLIST ')'  */
-#line 72 "s-expression-parser.y"
+  case 7: /* OPERATOR: '(' OPERANDLIST ')'  */
+#line 75 "s-expression-parser.y"
                               { (yyval.oprtr) = new libexpressions::parsers::Operator<std::string>(); (yyval.oprtr)->operands = std::move(*(yyvsp[-1].operandList)); delete (yyvsp[-1].operandList); }
-#line 1565 "s-expression-parser.tab.cpp"
+#line 1577 "s-expression-parser.tab.cpp"
     break;
 
-  case 7: /* RESULT: OPERANDLIST  */
-#line 73 "s-expression-parser.y"
+  case 8: /* RESULT: OPERANDLIST  */
+#line 76 "s-expression-parser.y"
                     { result = std::move(*(yyvsp[0].operandList)); delete (yyvsp[0].operandList); }
-#line 1571 "s-expression-parser.tab.cpp"
+#line 1583 "s-expression-parser.tab.cpp"
     break;
 
 
-#line 1575 "s-expression-parser.tab.cpp"
+#line 1587 "s-expression-parser.tab.cpp"
 
         default: break;
       }
@@ -1806,7 +1818,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 75 "s-expression-parser.y"
+#line 78 "s-expression-parser.y"
 
 
 /* Epilogue */
@@ -63,7 +63,8 @@ extern int libexpressions_s_expressiondebug;
     LIBEXPRESSIONS_S_EXPRESSIONerror = 256, /* error  */
     LIBEXPRESSIONS_S_EXPRESSIONUNDEF = 257, /* "invalid token"  */
     IDENTIFIER = 258,              /* IDENTIFIER  */
-    WHITESPACE = 259               /* WHITESPACE  */
+    LITERAL = 259,                 /* LITERAL  */
+    WHITESPACE = 260               /* WHITESPACE  */
   };
   typedef enum libexpressions_s_expressiontokentype libexpressions_s_expressiontoken_kind_t;
 #endif
@@ -75,12 +76,13 @@ union LIBEXPRESSIONS_S_EXPRESSIONSTYPE
 #line 41 "s-expression-parser.y"
 
 	libexpressions::parsers::AtomicProposition<std::string> *atom;
+	libexpressions::parsers::NumericLiteral *literal;
 	libexpressions::parsers::Operand<std::string> *operand;
 	std::vector<libexpressions::parsers::Operand<std::string>> *operandList;
 	libexpressions::parsers::Operator<std::string> *oprtr;
 	std::vector<libexpressions::parsers::Operator<std::string>> *operatorList;
 
-#line 84 "s-expression-parser.tab.hpp"
+#line 86 "s-expression-parser.tab.hpp"
 
 };
 typedef union LIBEXPRESSIONS_S_EXPRESSIONSTYPE LIBEXPRESSIONS_S_EXPRESSIONSTYPE;
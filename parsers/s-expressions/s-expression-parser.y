@@ -40,6 +40,7 @@ void libexpressions_s_expressionerror(libexpressions::parsers::ExpressionList<st
 
 %union {
 	libexpressions::parsers::AtomicProposition<std::string> *atom;
+	libexpressions::parsers::NumericLiteral *literal;
 	libexpressions::parsers::Operand<std::string> *operand;
 	std::vector<libexpressions::parsers::Operand<std::string>> *operandList;
 	libexpressions::parsers::Operator<std::string> *oprtr;
@@ -47,6 +48,7 @@ void libexpressions_s_expressionerror(libexpressions::parsers::ExpressionList<st
 }
 
 %token <atom> IDENTIFIER
+%token <literal> LITERAL
 %token WHITESPACE
 %nterm <operand> OPERAND
 %nterm <operandList> OPERANDLIST
@@ -66,6 +68,7 @@ void libexpressions_s_expressionerror(libexpressions::parsers::ExpressionList<st
 
 /* Grammar */
 OPERAND: IDENTIFIER { $OPERAND = new libexpressions::parsers::Operand<std::string>(*$IDENTIFIER); delete $IDENTIFIER; }
+			 | LITERAL { $OPERAND = new libexpressions::parsers::Operand<std::string>(std::move(*$LITERAL)); delete $LITERAL; }
 			 | OPERATOR { $OPERAND = new libexpressions::parsers::Operand<std::string>(*$OPERATOR); delete $OPERATOR; }
 OPERANDLIST[result]: OPERANDLIST[list] OPERAND { $result = $list; $result->push_back(std::move(*$OPERAND)); delete $OPERAND; }
 									 | %empty { $result = new std::vector<libexpressions::parsers::Operand<std::string>>(); }
@@ -1,4 +1,5 @@
 #include "libexpressions/utils/expression-tree-visit.hpp"
+#include "libexpressions/expressions/expression_visit_helper.hpp"
 
 #include <iterator>
 #include <cassert>
@@ -7,7 +8,7 @@ namespace libexpressions {
 
 template<>
 size_t getChildNodeIndex(libexpressions::ExpressionNodePtr const *parent, libexpressions::ExpressionNodePtr const *child) {
-    libexpressions::Operator const *op = dynamic_cast<libexpressions::Operator const*>(parent->get());
+    libexpressions::Operator const *op = libexpressions::dyn_cast<libexpressions::Operator>(parent->get());
     assert(op != nullptr); // ptr is a child of previous node. Thus, previous node must have children. Thus, previous node must be an operator.
     auto iter = std::find(op->begin(), op->end(), *child);
     assert(op->end() != iter); // We expect to find some child equal to ptr
@@ -15,7 +16,7 @@ size_t getChildNodeIndex(libexpressions::ExpressionNodePtr const *parent, libexp
 }
 
 std::tuple<libexpressions::Operator::Iterator, libexpressions::Operator::Iterator> getChildrenIteratorsForExpressionNode(libexpressions::ExpressionNodePtr const &nodePtr) {
-    if( auto ptr = dynamic_cast<libexpressions::Operator const*>(nodePtr.get()); ptr != nullptr ) {
+    if( auto ptr = libexpressions::dyn_cast<libexpressions::Operator>(nodePtr.get()); ptr != nullptr ) {
         return std::make_tuple(ptr->begin(), ptr->end());
     }
     return std::make_tuple(libexpressions::Operator::Iterator(), libexpressions::Operator::Iterator());